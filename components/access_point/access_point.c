@@ -4,12 +4,18 @@
 #include "esp_mac.h"
 #include "esp_netif.h"
 #include "esp_wifi.h"
+#include "event_bus.h"
 #include "lwip/ip4_addr.h"
 #include "radio_wazoo_config.h"
+#include "settings.h"
+#include "station.h"
+#include <stdio.h>
+#include <string.h>
 
 static const char *const TAG = "ACCESS_POINT";
 static bool netif_initialized = false;
 static esp_netif_t *ap_netif = NULL;
+static bool station_enabled = false;
 
 static void wifi_event_handler(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data) {
     if (event_id == WIFI_EVENT_AP_STACONNECTED) {
@@ -17,11 +23,17 @@ static void wifi_event_handler(void *arg, esp_event_base_t event_base, int32_t e
         // clang-format off
         ESP_LOGI(TAG, "Station "MACSTR" joined, AID=%d", MAC2STR(event->mac), event->aid);
         // clang-format on
+        event_station_t station = {.aid = event->aid};
+        memcpy(station.mac, event->mac, sizeof(station.mac));
+        event_bus_publish_station_joined(&station);
     } else if (event_id == WIFI_EVENT_AP_STADISCONNECTED) {
         wifi_event_ap_stadisconnected_t *event = (wifi_event_ap_stadisconnected_t *)event_data;
         // clang-format off
         ESP_LOGI(TAG, "Station "MACSTR" left, AID=%d", MAC2STR(event->mac), event->aid);
         // clang-format on
+        event_station_t station = {.aid = event->aid};
+        memcpy(station.mac, event->mac, sizeof(station.mac));
+        event_bus_publish_station_left(&station);
     }
 }
 
@@ -72,8 +84,18 @@ esp_err_t access_point_init(void) {
         wifi_config.ap.authmode = WIFI_AUTH_OPEN;
     }
 
-    ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_AP));
+    // Upstream network from settings; without an SSID the device stays a plain access point
+    char sta_ssid[33] = "";
+    char sta_password[65] = "";
+    settings_get_str("Network", "SSID", sta_ssid, sizeof(sta_ssid));
+    settings_get_str("Network", "Password", sta_password, sizeof(sta_password));
+    station_enabled = strlen(sta_ssid) > 0;
+
+    ESP_ERROR_CHECK(esp_wifi_set_mode(station_enabled ? WIFI_MODE_APSTA : WIFI_MODE_AP));
     ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_AP, &wifi_config));
+    if (station_enabled) {
+        ESP_ERROR_CHECK(station_init(sta_ssid, sta_password));
+    }
     ESP_ERROR_CHECK(esp_wifi_start());
 
     ESP_LOGI(TAG, "==================================");
@@ -81,6 +103,7 @@ esp_err_t access_point_init(void) {
     ESP_LOGI(TAG, "SSID: %s", WIFI_AP_SSID);
     ESP_LOGI(TAG, "Password: %s", strlen(WIFI_AP_PASSWORD) > 0 ? WIFI_AP_PASSWORD : "(open)");
     ESP_LOGI(TAG, "IP Address: " IPSTR, IP2STR(&ip_info.ip));
+    ESP_LOGI(TAG, "Upstream: %s", station_enabled ? sta_ssid : "(none, set Network/SSID)");
     ESP_LOGI(TAG, "==================================");
 
     return ESP_OK;
@@ -91,6 +114,12 @@ esp_err_t access_point_deinit(void) {
 
     ESP_LOGI(TAG, "Stopping WiFi Access Point...");
 
+    // Before esp_wifi_stop, so the disconnect it causes is not retried
+    if (station_enabled) {
+        station_deinit();
+        station_enabled = false;
+    }
+
     // Stop WiFi
     ret = esp_wifi_stop();
     if (ret != ESP_OK) {
@@ -122,3 +151,50 @@ esp_err_t access_point_deinit(void) {
 
     return ESP_OK;
 }
+
+esp_err_t access_point_get_ssid(char *ssid, size_t ssid_size) {
+    wifi_config_t config;
+    esp_err_t ret = esp_wifi_get_config(WIFI_IF_AP, &config);
+    if (ret != ESP_OK) {
+        ssid[0] = '\0';
+        return ret;
+    }
+
+    // 32-byte SSIDs are not NUL-terminated in the driver config
+    size_t len = config.ap.ssid_len;
+    if (len == 0 || len > sizeof(config.ap.ssid)) {
+        len = strnlen((const char *)config.ap.ssid, sizeof(config.ap.ssid));
+    }
+    snprintf(ssid, ssid_size, "%.*s", (int)len, (const char *)config.ap.ssid);
+    return ESP_OK;
+}
+
+size_t access_point_network_to_json(char *buffer, size_t buffer_size) {
+    int n = snprintf(buffer, buffer_size, "{\"mode\":\"%s\",\"ap\":{\"ssid\":\"%s\",\"channel\":%d},\"sta\":",
+                     station_enabled ? "apsta" : "ap", WIFI_AP_SSID, WIFI_AP_CHANNEL);
+    if (n < 0 || (size_t)n >= buffer_size) {
+        return 0;
+    }
+    size_t len = n;
+
+    if (station_enabled) {
+        size_t sta_len = station_to_json(buffer + len, buffer_size - len);
+        if (sta_len == 0) {
+            return 0;
+        }
+        len += sta_len;
+    } else {
+        n = snprintf(buffer + len, buffer_size - len, "null");
+        if (n < 0 || (size_t)n >= buffer_size - len) {
+            return 0;
+        }
+        len += n;
+    }
+
+    if (len + 2 > buffer_size) {
+        return 0;
+    }
+    buffer[len++] = '}';
+    buffer[len] = '\0';
+    return len;
+}
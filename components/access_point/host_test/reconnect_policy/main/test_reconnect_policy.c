@@ -0,0 +1,153 @@
+#include "reconnect_policy.h"
+#include "unity.h"
+#include <stdlib.h>
+
+#define BASE_MS      250
+#define MAX_MS       30000
+#define MAX_FAILURES 3
+#define S(x)         ((int64_t)((x) * 1000000))
+
+static reconnect_policy_t policy;
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+static void test_backoff_doubles_to_cap(void) {
+    static const uint32_t expected[] = {0, 250, 500, 1000, 2000, 4000, 8000, 16000, 30000, 30000};
+
+    reconnect_policy_init(&policy, BASE_MS, MAX_MS, MAX_FAILURES, false);
+    reconnect_action_t action = reconnect_policy_start(&policy, S(1));
+    TEST_ASSERT_EQUAL_UINT32(0, action.delay_ms);
+    TEST_ASSERT_FALSE(action.use_cache);
+
+    for (size_t i = 0; i < sizeof(expected) / sizeof(expected[0]); i++) {
+        action = reconnect_policy_disconnected(&policy, S(2 + i), false);
+        TEST_ASSERT_EQUAL_UINT32_MESSAGE(expected[i], action.delay_ms, "retry delay");
+        TEST_ASSERT_FALSE(action.use_cache);
+        TEST_ASSERT_FALSE(action.forget_cache);
+    }
+}
+
+static void test_backoff_stays_capped_when_failures_saturate(void) {
+    reconnect_policy_init(&policy, BASE_MS, MAX_MS, MAX_FAILURES, false);
+    reconnect_policy_start(&policy, S(1));
+
+    reconnect_action_t action;
+    for (int i = 0; i < 300; i++) {
+        action = reconnect_policy_disconnected(&policy, S(2 + i), false);
+    }
+    TEST_ASSERT_EQUAL_UINT8(UINT8_MAX, policy.failures);
+    TEST_ASSERT_EQUAL_UINT32(MAX_MS, action.delay_ms);
+}
+
+static void test_backoff_restarts_after_connect(void) {
+    reconnect_policy_init(&policy, BASE_MS, MAX_MS, MAX_FAILURES, false);
+    reconnect_policy_start(&policy, S(1));
+    for (int i = 0; i < 5; i++) {
+        reconnect_policy_disconnected(&policy, S(2 + i), false);
+    }
+    reconnect_policy_connected(&policy, S(10));
+
+    // A drop of an established link retries at once, then backs off from the base again
+    TEST_ASSERT_EQUAL_UINT32(0, reconnect_policy_disconnected(&policy, S(20), false).delay_ms);
+    TEST_ASSERT_EQUAL_UINT32(BASE_MS, reconnect_policy_disconnected(&policy, S(21), false).delay_ms);
+}
+
+static void test_cache_forgotten_when_ap_not_found(void) {
+    reconnect_policy_init(&policy, BASE_MS, MAX_MS, MAX_FAILURES, true);
+    reconnect_action_t action = reconnect_policy_start(&policy, S(1));
+    TEST_ASSERT_TRUE(action.use_cache);
+
+    action = reconnect_policy_disconnected(&policy, S(2), true);
+    TEST_ASSERT_TRUE(action.forget_cache);
+    TEST_ASSERT_FALSE(action.use_cache);
+    TEST_ASSERT_FALSE(policy.cache_valid);
+    TEST_ASSERT_EQUAL_UINT32(1, policy.cache_invalidations);
+
+    // Scanning attempts do not count against a cache that is already gone
+    action = reconnect_policy_disconnected(&policy, S(3), true);
+    TEST_ASSERT_FALSE(action.forget_cache);
+    TEST_ASSERT_FALSE(action.use_cache);
+    TEST_ASSERT_EQUAL_UINT32(1, policy.cache_invalidations);
+}
+
+static void test_cache_forgotten_after_repeated_failures(void) {
+    reconnect_policy_init(&policy, BASE_MS, MAX_MS, MAX_FAILURES, true);
+    reconnect_policy_start(&policy, S(1));
+
+    for (int i = 1; i < MAX_FAILURES; i++) {
+        reconnect_action_t action = reconnect_policy_disconnected(&policy, S(1 + i), false);
+        TEST_ASSERT_TRUE(action.use_cache);
+        TEST_ASSERT_FALSE(action.forget_cache);
+    }
+
+    reconnect_action_t action = reconnect_policy_disconnected(&policy, S(10), false);
+    TEST_ASSERT_TRUE(action.forget_cache);
+    TEST_ASSERT_FALSE(action.use_cache);
+    TEST_ASSERT_EQUAL_UINT32(1, policy.cache_invalidations);
+}
+
+static void test_link_drop_does_not_count_as_cache_failure(void) {
+    reconnect_policy_init(&policy, BASE_MS, MAX_MS, 1, true);
+    reconnect_policy_start(&policy, S(1));
+    reconnect_policy_connected(&policy, S(2));
+
+    // Losing an established link says nothing about the cached BSSID
+    reconnect_action_t action = reconnect_policy_disconnected(&policy, S(10), false);
+    TEST_ASSERT_TRUE(action.use_cache);
+    TEST_ASSERT_FALSE(action.forget_cache);
+}
+
+static void test_saved_cache_used_after_scan(void) {
+    reconnect_policy_init(&policy, BASE_MS, MAX_MS, MAX_FAILURES, false);
+    reconnect_policy_start(&policy, S(1));
+    reconnect_policy_cache_saved(&policy);
+    reconnect_policy_connected(&policy, S(2));
+
+    reconnect_action_t action = reconnect_policy_disconnected(&policy, S(10), false);
+    TEST_ASSERT_TRUE(action.use_cache);
+}
+
+static void test_latency_stats(void) {
+    reconnect_policy_init(&policy, BASE_MS, MAX_MS, MAX_FAILURES, false);
+
+    // Initial connection by scan, 2 s after start; not a reconnect
+    reconnect_policy_start(&policy, S(1));
+    reconnect_policy_cache_saved(&policy);
+    reconnect_policy_connected(&policy, S(3));
+    TEST_ASSERT_EQUAL_INT64(S(2), policy.initial_us);
+    TEST_ASSERT_EQUAL_UINT32(0, policy.reconnects);
+    TEST_ASSERT_EQUAL_UINT32(1, policy.scan_connects);
+
+    // Drop at 10 s, back through the cache at 10.5 s
+    reconnect_policy_disconnected(&policy, S(10), false);
+    reconnect_policy_connected(&policy, S(10.5));
+    TEST_ASSERT_EQUAL_INT64(S(0.5), policy.last_us);
+
+    // Drop at 20 s, one failed attempt, back at 21.5 s
+    reconnect_policy_disconnected(&policy, S(20), false);
+    reconnect_policy_disconnected(&policy, S(20.2), false);
+    reconnect_policy_connected(&policy, S(21.5));
+
+    TEST_ASSERT_EQUAL_UINT32(2, policy.reconnects);
+    TEST_ASSERT_EQUAL_UINT32(2, policy.cached_connects);
+    TEST_ASSERT_EQUAL_INT64(S(1.5), policy.last_us);
+    TEST_ASSERT_EQUAL_INT64(S(1.5), policy.max_us);
+    TEST_ASSERT_EQUAL_INT64(S(2), policy.total_us);
+    TEST_ASSERT_EQUAL_INT64(S(2), policy.initial_us);
+    TEST_ASSERT_EQUAL_INT64(0, policy.down_since_us);
+}
+
+void app_main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_backoff_doubles_to_cap);
+    RUN_TEST(test_backoff_stays_capped_when_failures_saturate);
+    RUN_TEST(test_backoff_restarts_after_connect);
+    RUN_TEST(test_cache_forgotten_when_ap_not_found);
+    RUN_TEST(test_cache_forgotten_after_repeated_failures);
+    RUN_TEST(test_link_drop_does_not_count_as_cache_failure);
+    RUN_TEST(test_saved_cache_used_after_scan);
+    RUN_TEST(test_latency_stats);
+    exit(UNITY_END());
+}
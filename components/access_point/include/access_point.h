@@ -2,6 +2,7 @@
 #define ACCESS_POINT_H
 
 #include <esp_err.h>
+#include <stddef.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -10,6 +11,10 @@ extern "C" {
 /**
  * @brief Initialize WiFi Access Point
  *
+ * When the Network/SSID setting is set, runs in AP+STA mode and keeps the
+ * station connected upstream (cached BSSID/channel, exponential backoff).
+ * Call after settings_init().
+ *
  * @return esp_err_t ESP_OK on success
  */
 esp_err_t access_point_init(void);
@@ -21,6 +26,29 @@ esp_err_t access_point_init(void);
  */
 esp_err_t access_point_deinit(void);
 
+/**
+ * @brief Get the SSID the access point is broadcasting
+ *
+ * Read from the WiFi driver, so it reflects the running configuration.
+ *
+ * @param ssid Output buffer, at least 33 bytes for the longest SSID
+ * @param ssid_size Size of ssid
+ * @return esp_err_t ESP_OK on success, or the driver error (ssid is then empty)
+ */
+esp_err_t access_point_get_ssid(char *ssid, size_t ssid_size);
+
+/**
+ * @brief Render mode, access point and station state as JSON
+ *
+ * Includes station reconnect statistics (cached vs. scanned connects,
+ * outage latency) when AP+STA mode is active.
+ *
+ * @param buffer Output buffer
+ * @param buffer_size Size of buffer
+ * @return size_t JSON length, 0 if the buffer was too small
+ */
+size_t access_point_network_to_json(char *buffer, size_t buffer_size);
+
 #ifdef __cplusplus
 }
 #endif
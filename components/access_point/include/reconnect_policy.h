@@ -0,0 +1,96 @@
+#ifndef RECONNECT_POLICY_H
+#define RECONNECT_POLICY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Station reconnect decisions and latency statistics.
+ *
+ * Pure logic with no ESP-IDF dependencies: the caller feeds it connection
+ * events with timestamps and carries out the returned action, so the policy
+ * can be driven by a simulated event source on the host.
+ */
+typedef struct {
+    uint32_t base_ms;         // second retry delay, doubled per failure
+    uint32_t max_ms;          // backoff cap
+    uint8_t cache_max_failures;
+
+    bool cache_valid;         // a BSSID/channel from the last good connection is available
+    bool attempt_cached;      // the attempt in flight targets the cached BSSID/channel
+    uint8_t failures;         // consecutive failed attempts
+    uint8_t cache_failures;   // consecutive failed attempts using the cache
+    int64_t down_since_us;    // start of the current outage, 0 while connected
+    bool ever_connected;
+
+    uint32_t reconnects;
+    uint32_t cached_connects;
+    uint32_t scan_connects;
+    uint32_t cache_invalidations;
+    int64_t initial_us;       // first connection after start
+    int64_t last_us;
+    int64_t max_us;
+    int64_t total_us;
+} reconnect_policy_t;
+
+typedef struct {
+    uint32_t delay_ms;   // wait this long before connecting
+    bool use_cache;      // connect to the cached BSSID/channel instead of scanning
+    bool forget_cache;   // the cached BSSID/channel is stale, delete it
+} reconnect_action_t;
+
+/**
+ * @brief Reset the policy
+ *
+ * @param policy Policy state
+ * @param base_ms Delay before the second retry (the first is immediate)
+ * @param max_ms Maximum delay
+ * @param cache_max_failures Failed cached attempts before falling back to a full scan
+ * @param cache_valid Whether a cached BSSID/channel was loaded
+ */
+void reconnect_policy_init(reconnect_policy_t *policy, uint32_t base_ms, uint32_t max_ms, uint8_t cache_max_failures,
+                           bool cache_valid);
+
+/**
+ * @brief Decide how to make the first connection
+ *
+ * @param policy Policy state
+ * @param now_us Current time
+ * @return reconnect_action_t Action to take
+ */
+reconnect_action_t reconnect_policy_start(reconnect_policy_t *policy, int64_t now_us);
+
+/**
+ * @brief Handle a lost connection or failed attempt
+ *
+ * @param policy Policy state
+ * @param now_us Current time
+ * @param ap_not_found The AP was not found on the cached channel
+ * @return reconnect_action_t Action to take
+ */
+reconnect_action_t reconnect_policy_disconnected(reconnect_policy_t *policy, int64_t now_us, bool ap_not_found);
+
+/**
+ * @brief Handle a successful connection (IP acquired)
+ *
+ * @param policy Policy state
+ * @param now_us Current time
+ */
+void reconnect_policy_connected(reconnect_policy_t *policy, int64_t now_us);
+
+/**
+ * @brief Note that a BSSID/channel was saved after connecting
+ *
+ * @param policy Policy state
+ */
+void reconnect_policy_cache_saved(reconnect_policy_t *policy);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // RECONNECT_POLICY_H
@@ -0,0 +1,82 @@
+#include "reconnect_policy.h"
+#include <string.h>
+
+void reconnect_policy_init(reconnect_policy_t *policy, uint32_t base_ms, uint32_t max_ms, uint8_t cache_max_failures,
+                           bool cache_valid) {
+    memset(policy, 0, sizeof(*policy));
+    policy->base_ms = base_ms;
+    policy->max_ms = max_ms;
+    policy->cache_max_failures = cache_max_failures;
+    policy->cache_valid = cache_valid;
+}
+
+reconnect_action_t reconnect_policy_start(reconnect_policy_t *policy, int64_t now_us) {
+    policy->down_since_us = now_us;
+    policy->attempt_cached = policy->cache_valid;
+
+    reconnect_action_t action = {.delay_ms = 0, .use_cache = policy->cache_valid, .forget_cache = false};
+    return action;
+}
+
+reconnect_action_t reconnect_policy_disconnected(reconnect_policy_t *policy, int64_t now_us, bool ap_not_found) {
+    reconnect_action_t action = {0};
+
+    if (policy->down_since_us == 0) {
+        policy->down_since_us = now_us; // an established link dropped, not a failed attempt
+    } else if (policy->attempt_cached) {
+        policy->cache_failures++;
+        // The AP moved channel or went away: scanning is the only way to find it again
+        if (ap_not_found || policy->cache_failures >= policy->cache_max_failures) {
+            policy->cache_valid = false;
+            policy->cache_failures = 0;
+            policy->cache_invalidations++;
+            action.forget_cache = true;
+        }
+    }
+
+    // First retry is immediate since most drops are transient; after that back off exponentially
+    if (policy->failures > 0) {
+        uint32_t shift = policy->failures - 1;
+        uint64_t delay = shift < 16 ? (uint64_t)policy->base_ms << shift : policy->max_ms;
+        action.delay_ms = delay > policy->max_ms ? policy->max_ms : (uint32_t)delay;
+    }
+    if (policy->failures < UINT8_MAX) {
+        policy->failures++;
+    }
+
+    action.use_cache = policy->cache_valid;
+    policy->attempt_cached = action.use_cache;
+    return action;
+}
+
+void reconnect_policy_connected(reconnect_policy_t *policy, int64_t now_us) {
+    if (policy->down_since_us != 0) {
+        int64_t latency = now_us - policy->down_since_us;
+        if (!policy->ever_connected) {
+            policy->initial_us = latency;
+        } else {
+            policy->reconnects++;
+            policy->last_us = latency;
+            policy->total_us += latency;
+            if (latency > policy->max_us) {
+                policy->max_us = latency;
+            }
+        }
+    }
+
+    if (policy->attempt_cached) {
+        policy->cached_connects++;
+    } else {
+        policy->scan_connects++;
+    }
+
+    policy->ever_connected = true;
+    policy->down_since_us = 0;
+    policy->failures = 0;
+    policy->cache_failures = 0;
+}
+
+void reconnect_policy_cache_saved(reconnect_policy_t *policy) {
+    policy->cache_valid = true;
+    policy->cache_failures = 0;
+}
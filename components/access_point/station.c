@@ -0,0 +1,264 @@
+#include "station.h"
+#include "esp_event.h"
+#include "esp_log.h"
+#include "esp_mac.h"
+#include "esp_netif.h"
+#include "esp_timer.h"
+#include "esp_wifi.h"
+#include "freertos/FreeRTOS.h"
+#include "nvs.h"
+#include "radio_wazoo_config.h"
+#include "reconnect_policy.h"
+#include <stdio.h>
+#include <string.h>
+
+static const char *const TAG = "STATION";
+
+// NVS keys for the last good connection
+#define CACHE_KEY_SSID    "sta_ssid"
+#define CACHE_KEY_BSSID   "sta_bssid"
+#define CACHE_KEY_CHANNEL "sta_chan"
+
+static esp_netif_t *sta_netif = NULL;
+static esp_timer_handle_t retry_timer = NULL;
+static wifi_config_t sta_config;
+static reconnect_policy_t policy;
+static portMUX_TYPE policy_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static uint8_t cached_bssid[6];
+static uint8_t cached_channel = 0;
+static volatile bool connected = false;
+static volatile bool stopping = false;
+
+static bool load_cache(const char *ssid) {
+    char value[33];
+    int32_t channel;
+
+    if (nvs_cache_get_str(CACHE_KEY_SSID, value, sizeof(value)) != ESP_OK || strcmp(value, ssid) != 0) {
+        return false;
+    }
+    if (nvs_cache_get_str(CACHE_KEY_BSSID, value, sizeof(value)) != ESP_OK ||
+        sscanf(value, "%hhx:%hhx:%hhx:%hhx:%hhx:%hhx", &cached_bssid[0], &cached_bssid[1], &cached_bssid[2],
+               &cached_bssid[3], &cached_bssid[4], &cached_bssid[5]) != 6) {
+        return false;
+    }
+    if (nvs_cache_get_i32(CACHE_KEY_CHANNEL, &channel) != ESP_OK || channel < 1 || channel > 14) {
+        return false;
+    }
+
+    cached_channel = (uint8_t)channel;
+    return true;
+}
+
+// Returns true once the cache matches the current connection
+static bool save_cache(const uint8_t *bssid, uint8_t channel) {
+    if (channel == cached_channel && memcmp(bssid, cached_bssid, sizeof(cached_bssid)) == 0) {
+        return true; // unchanged, spare the flash
+    }
+
+    char value[18];
+    snprintf(value, sizeof(value), MACSTR, MAC2STR(bssid));
+    if (nvs_cache_put_str(CACHE_KEY_SSID, (const char *)sta_config.sta.ssid) != ESP_OK ||
+        nvs_cache_put_str(CACHE_KEY_BSSID, value) != ESP_OK || nvs_cache_put_i32(CACHE_KEY_CHANNEL, channel) != ESP_OK) {
+        return false;
+    }
+
+    memcpy(cached_bssid, bssid, sizeof(cached_bssid));
+    cached_channel = channel;
+    ESP_LOGI(TAG, "Cached BSSID %s on channel %d for fast reconnect", value, channel);
+    return true;
+}
+
+static void forget_cache(void) {
+    nvs_cache_forget(CACHE_KEY_SSID);
+    nvs_cache_forget(CACHE_KEY_BSSID);
+    nvs_cache_forget(CACHE_KEY_CHANNEL);
+    cached_channel = 0;
+    memset(cached_bssid, 0, sizeof(cached_bssid));
+    ESP_LOGW(TAG, "Cached BSSID/channel is stale, falling back to a full scan");
+}
+
+static void retry_timer_callback(void *arg) {
+    if (!stopping) {
+        esp_wifi_connect();
+    }
+}
+
+static void apply(reconnect_action_t action) {
+    if (action.forget_cache) {
+        forget_cache();
+    }
+
+    if (action.use_cache) {
+        // Straight to the known AP on its channel, no scan
+        sta_config.sta.bssid_set = true;
+        memcpy(sta_config.sta.bssid, cached_bssid, sizeof(cached_bssid));
+        sta_config.sta.channel = cached_channel;
+        sta_config.sta.scan_method = WIFI_FAST_SCAN;
+    } else {
+        sta_config.sta.bssid_set = false;
+        sta_config.sta.channel = 0;
+        sta_config.sta.scan_method = WIFI_ALL_CHANNEL_SCAN;
+        sta_config.sta.sort_method = WIFI_CONNECT_AP_BY_SIGNAL;
+    }
+    esp_wifi_set_config(WIFI_IF_STA, &sta_config);
+
+    if (action.delay_ms == 0) {
+        esp_wifi_connect();
+    } else {
+        ESP_LOGI(TAG, "Reconnecting in %lu ms (%s)", (unsigned long)action.delay_ms,
+                 action.use_cache ? "cached BSSID" : "full scan");
+        esp_timer_start_once(retry_timer, (uint64_t)action.delay_ms * 1000);
+    }
+}
+
+static void event_handler(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data) {
+    int64_t now = esp_timer_get_time();
+    reconnect_action_t action;
+
+    if (stopping) {
+        return;
+    }
+
+    if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_START) {
+        taskENTER_CRITICAL(&policy_lock);
+        action = reconnect_policy_start(&policy, now);
+        taskEXIT_CRITICAL(&policy_lock);
+        apply(action);
+    } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_CONNECTED) {
+        wifi_event_sta_connected_t *event = (wifi_event_sta_connected_t *)event_data;
+        if (save_cache(event->bssid, event->channel)) {
+            taskENTER_CRITICAL(&policy_lock);
+            reconnect_policy_cache_saved(&policy);
+            taskEXIT_CRITICAL(&policy_lock);
+        }
+    } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_DISCONNECTED) {
+        wifi_event_sta_disconnected_t *event = (wifi_event_sta_disconnected_t *)event_data;
+        if (connected) {
+            ESP_LOGW(TAG, "Disconnected from %s (reason %d)", (const char *)sta_config.sta.ssid, event->reason);
+        }
+        connected = false;
+        taskENTER_CRITICAL(&policy_lock);
+        action = reconnect_policy_disconnected(&policy, now, event->reason == WIFI_REASON_NO_AP_FOUND);
+        taskEXIT_CRITICAL(&policy_lock);
+        apply(action);
+    } else if (event_base == IP_EVENT && event_id == IP_EVENT_STA_GOT_IP) {
+        ip_event_got_ip_t *event = (ip_event_got_ip_t *)event_data;
+        taskENTER_CRITICAL(&policy_lock);
+        bool was_cached = policy.attempt_cached;
+        int64_t outage = policy.down_since_us != 0 ? now - policy.down_since_us : 0;
+        reconnect_policy_connected(&policy, now);
+        taskEXIT_CRITICAL(&policy_lock);
+        connected = true;
+        ESP_LOGI(TAG, "Connected to %s, IP " IPSTR " after %lld ms (%s)", (const char *)sta_config.sta.ssid,
+                 IP2STR(&event->ip_info.ip), outage / 1000, was_cached ? "cached BSSID" : "full scan");
+    }
+}
+
+esp_err_t station_init(const char *ssid, const char *password) {
+    esp_err_t ret;
+
+    stopping = false;
+    sta_netif = esp_netif_create_default_wifi_sta();
+
+    memset(&sta_config, 0, sizeof(sta_config));
+    snprintf((char *)sta_config.sta.ssid, sizeof(sta_config.sta.ssid), "%s", ssid);
+    snprintf((char *)sta_config.sta.password, sizeof(sta_config.sta.password), "%s", password);
+    sta_config.sta.threshold.authmode = strlen(password) > 0 ? WIFI_AUTH_WPA2_PSK : WIFI_AUTH_OPEN;
+    sta_config.sta.pmf_cfg.capable = true;
+
+    bool cache_valid = load_cache(ssid);
+    reconnect_policy_init(&policy, WIFI_STA_BACKOFF_BASE_MS, WIFI_STA_BACKOFF_MAX_MS, WIFI_STA_CACHE_MAX_FAILURES,
+                          cache_valid);
+
+    esp_timer_create_args_t timer_args = {
+        .callback = retry_timer_callback,
+        .name = "sta_retry",
+    };
+    ret = esp_timer_create(&timer_args, &retry_timer);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create retry timer: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    ret = esp_event_handler_register(WIFI_EVENT, ESP_EVENT_ANY_ID, &event_handler, NULL);
+    if (ret == ESP_OK) {
+        ret = esp_event_handler_register(IP_EVENT, IP_EVENT_STA_GOT_IP, &event_handler, NULL);
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to register event handler: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    ret = esp_wifi_set_config(WIFI_IF_STA, &sta_config);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to configure station: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    if (cache_valid) {
+        // clang-format off
+        ESP_LOGI(TAG, "Station SSID: %s, cached BSSID "MACSTR" channel %d", ssid, MAC2STR(cached_bssid), cached_channel);
+        // clang-format on
+    } else {
+        ESP_LOGI(TAG, "Station SSID: %s, no cached BSSID (full scan)", ssid);
+    }
+
+    return ESP_OK;
+}
+
+void station_deinit(void) {
+    stopping = true;
+
+    if (retry_timer != NULL) {
+        esp_timer_stop(retry_timer);
+        esp_timer_delete(retry_timer);
+        retry_timer = NULL;
+    }
+
+    esp_event_handler_unregister(WIFI_EVENT, ESP_EVENT_ANY_ID, &event_handler);
+    esp_event_handler_unregister(IP_EVENT, IP_EVENT_STA_GOT_IP, &event_handler);
+
+    if (sta_netif != NULL) {
+        esp_netif_destroy(sta_netif);
+        sta_netif = NULL;
+    }
+    connected = false;
+}
+
+size_t station_to_json(char *buffer, size_t buffer_size) {
+    reconnect_policy_t snapshot;
+    wifi_ap_record_t ap_info;
+    int rssi = 0;
+    char ssid[sizeof(sta_config.sta.ssid) + 1];
+
+    // The SSID is user-supplied; keep the JSON valid without a full escaper
+    snprintf(ssid, sizeof(ssid), "%s", (const char *)sta_config.sta.ssid);
+    for (char *p = ssid; *p != '\0'; p++) {
+        if (*p == '"' || *p == '\\' || (unsigned char)*p < 0x20) {
+            *p = '?';
+        }
+    }
+
+    taskENTER_CRITICAL(&policy_lock);
+    snapshot = policy;
+    taskEXIT_CRITICAL(&policy_lock);
+
+    bool is_connected = connected;
+    if (is_connected && esp_wifi_sta_get_ap_info(&ap_info) == ESP_OK) {
+        rssi = ap_info.rssi;
+    }
+
+    int n = snprintf(buffer, buffer_size,
+                     "{\"ssid\":\"%s\",\"connected\":%s,\"rssi\":%d,\"cached\":%s,\"failures\":%u,"
+                     "\"connects\":{\"cached\":%lu,\"scan\":%lu},\"cache_invalidations\":%lu,"
+                     "\"latency_ms\":{\"initial\":%lld,\"last\":%lld,\"avg\":%lld,\"max\":%lld},\"reconnects\":%lu}",
+                     ssid, is_connected ? "true" : "false", rssi,
+                     snapshot.cache_valid ? "true" : "false", snapshot.failures,
+                     (unsigned long)snapshot.cached_connects, (unsigned long)snapshot.scan_connects,
+                     (unsigned long)snapshot.cache_invalidations, snapshot.initial_us / 1000, snapshot.last_us / 1000,
+                     snapshot.reconnects > 0 ? snapshot.total_us / snapshot.reconnects / 1000 : 0,
+                     snapshot.max_us / 1000, (unsigned long)snapshot.reconnects);
+
+    return (n < 0 || (size_t)n >= buffer_size) ? 0 : (size_t)n;
+}
@@ -0,0 +1,42 @@
+#ifndef STATION_H
+#define STATION_H
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Configure the station interface and register its event handlers
+ *
+ * Call after esp_wifi_init() with WIFI_MODE_APSTA set and before
+ * esp_wifi_start(); the first connection attempt starts on WIFI_EVENT_STA_START.
+ *
+ * @param ssid Upstream network SSID
+ * @param password Upstream network password, empty for open networks
+ * @return esp_err_t ESP_OK on success
+ */
+esp_err_t station_init(const char *ssid, const char *password);
+
+/**
+ * @brief Stop reconnecting and unregister event handlers
+ */
+void station_deinit(void);
+
+/**
+ * @brief Render station state and reconnect statistics as JSON
+ *
+ * @param buffer Output buffer
+ * @param buffer_size Size of buffer
+ * @return size_t JSON length, 0 if the buffer was too small
+ */
+size_t station_to_json(char *buffer, size_t buffer_size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // STATION_H
@@ -0,0 +1,76 @@
+#include "audio_dsp.h"
+#include "audio_output.h"
+#include "esp_log.h"
+#include "sdkconfig.h"
+#include <string.h>
+
+#if CONFIG_IDF_TARGET_LINUX
+#include <time.h>
+#define BENCH_UNIT "ns"
+static inline uint32_t bench_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)(ts.tv_sec * 1000000000ull + ts.tv_nsec);
+}
+#else
+#include "esp_cpu.h"
+#define BENCH_UNIT "cycles"
+static inline uint32_t bench_now(void) {
+    return esp_cpu_get_cycle_count();
+}
+#endif
+
+static const char *const TAG = "AUDIO_BENCH";
+
+#define BENCH_FRAMES     1024
+#define BENCH_ITERATIONS 32
+
+static int16_t bench_in[BENCH_FRAMES * 2];
+static int16_t bench_out[BENCH_FRAMES * 2 * 2]; // room for upsampling
+
+// Same dispatch as audio_output_write(): matching rates are copied, only mismatched rates are resampled
+static void bench_convert(uint32_t src_rate, uint32_t dst_rate) {
+    audio_resampler_t rs;
+    audio_resampler_init(&rs, src_rate, dst_rate);
+
+    uint32_t start = bench_now();
+    for (int i = 0; i < BENCH_ITERATIONS; i++) {
+        if (src_rate == dst_rate) {
+            memcpy(bench_out, bench_in, sizeof(bench_in));
+        } else {
+            size_t consumed;
+            audio_resample(&rs, bench_in, BENCH_FRAMES, bench_out, BENCH_FRAMES * 2, &consumed);
+        }
+    }
+    uint32_t elapsed = bench_now() - start;
+
+    ESP_LOGI(TAG, "%s %lu->%lu: %lu %s / 1024 frames", src_rate == dst_rate ? "copy" : "resample",
+             (unsigned long)src_rate, (unsigned long)dst_rate, (unsigned long)(elapsed / BENCH_ITERATIONS), BENCH_UNIT);
+}
+
+void audio_output_benchmark(void) {
+    // Deterministic sawtooth test signal, content does not affect timing
+    for (int i = 0; i < BENCH_FRAMES * 2; i++) {
+        bench_in[i] = (int16_t)((i * 97) & 0xFFFF);
+    }
+
+    bench_convert(44100, 48000);
+    bench_convert(48000, 44100);
+    bench_convert(48000, 48000);
+
+    uint32_t start = bench_now();
+    for (int i = 0; i < BENCH_ITERATIONS; i++) {
+        audio_scale_volume(bench_out, BENCH_FRAMES * 2, 20000);
+    }
+    uint32_t elapsed = bench_now() - start;
+    ESP_LOGI(TAG, "volume: %lu %s / 1024 frames", (unsigned long)(elapsed / BENCH_ITERATIONS), BENCH_UNIT);
+
+    audio_sink_null.open(48000);
+    start = bench_now();
+    for (int i = 0; i < BENCH_ITERATIONS; i++) {
+        audio_sink_null.write(bench_out, BENCH_FRAMES);
+    }
+    elapsed = bench_now() - start;
+    audio_sink_null.close();
+    ESP_LOGI(TAG, "null sink write: %lu %s / 1024 frames", (unsigned long)(elapsed / BENCH_ITERATIONS), BENCH_UNIT);
+}
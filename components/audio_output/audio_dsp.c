@@ -0,0 +1,57 @@
+#include "audio_dsp.h"
+
+void audio_resampler_init(audio_resampler_t *rs, uint32_t src_rate, uint32_t dst_rate) {
+    rs->step = (uint32_t)(((uint64_t)src_rate << 16) / dst_rate);
+    rs->pos = 1u << 16; // first output lands on the first frame of the first block
+    rs->last[0] = 0;
+    rs->last[1] = 0;
+}
+
+size_t audio_resample(audio_resampler_t *rs, const int16_t *in, size_t in_frames, int16_t *out, size_t out_frames,
+                      size_t *consumed) {
+    // Fractions are reduced to Q15 so a full-scale delta times the fraction fits in 32 bits
+    uint32_t pos = rs->pos;
+    const uint32_t step = rs->step;
+    size_t produced = 0;
+
+    // Head: interpolation between the previous block's last frame and in[0]
+    while (produced < out_frames && (pos >> 16) == 0 && in_frames > 0) {
+        int32_t frac = (int32_t)(pos & 0xFFFF) >> 1;
+        out[2 * produced] = (int16_t)(rs->last[0] + (((in[0] - rs->last[0]) * frac) >> 15));
+        out[2 * produced + 1] = (int16_t)(rs->last[1] + (((in[1] - rs->last[1]) * frac) >> 15));
+        produced++;
+        pos += step;
+    }
+
+    // Body: both neighbours inside the current block, no branches in the loop
+    const uint32_t limit = (uint32_t)in_frames << 16;
+    while (produced < out_frames && pos < limit) {
+        const int16_t *a = in + 2 * ((pos >> 16) - 1);
+        int32_t frac = (int32_t)(pos & 0xFFFF) >> 1;
+        out[2 * produced] = (int16_t)(a[0] + (((a[2] - a[0]) * frac) >> 15));
+        out[2 * produced + 1] = (int16_t)(a[1] + (((a[3] - a[1]) * frac) >> 15));
+        produced++;
+        pos += step;
+    }
+
+    size_t used = pos >> 16;
+    if (used > in_frames) {
+        used = in_frames;
+    }
+    if (used > 0) {
+        rs->last[0] = in[2 * (used - 1)];
+        rs->last[1] = in[2 * (used - 1) + 1];
+        pos -= (uint32_t)used << 16;
+    }
+
+    rs->pos = pos;
+    *consumed = used;
+    return produced;
+}
+
+void audio_scale_volume(int16_t *samples, size_t count, int32_t gain_q15) {
+    // |sample * gain| <= 2^30, so the product never overflows and never needs saturation
+    for (size_t i = 0; i < count; i++) {
+        samples[i] = (int16_t)((samples[i] * gain_q15) >> 15);
+    }
+}
@@ -0,0 +1,59 @@
+#ifndef AUDIO_DSP_H
+#define AUDIO_DSP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Linear-interpolating stereo resampler, Q16.16 fixed point.
+ *
+ * Position 0 is the last frame of the previous block, position 1 is the
+ * first frame of the current block, so blocks join without clicks.
+ */
+typedef struct {
+    uint32_t step;   // source frames per output frame, Q16.16
+    uint32_t pos;    // read position, Q16.16
+    int16_t last[2]; // last consumed stereo frame
+} audio_resampler_t;
+
+/**
+ * @brief Reset resampler for a rate pair
+ *
+ * @param rs Resampler state
+ * @param src_rate Source sample rate in Hz
+ * @param dst_rate Destination sample rate in Hz
+ */
+void audio_resampler_init(audio_resampler_t *rs, uint32_t src_rate, uint32_t dst_rate);
+
+/**
+ * @brief Resample interleaved stereo frames
+ *
+ * @param rs Resampler state
+ * @param in Source frames
+ * @param in_frames Number of source frames
+ * @param out Destination frames
+ * @param out_frames Capacity of destination in frames
+ * @param consumed Number of source frames fully consumed
+ * @return size_t Number of frames written to out
+ */
+size_t audio_resample(audio_resampler_t *rs, const int16_t *in, size_t in_frames, int16_t *out, size_t out_frames,
+                      size_t *consumed);
+
+/**
+ * @brief Scale samples in place by a Q15 gain (32768 = unity)
+ *
+ * @param samples Samples to scale
+ * @param count Number of samples (not frames)
+ * @param gain_q15 Gain 0..32768
+ */
+void audio_scale_volume(int16_t *samples, size_t count, int32_t gain_q15);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // AUDIO_DSP_H
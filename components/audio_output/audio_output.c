@@ -0,0 +1,283 @@
+#include "audio_output.h"
+#include "audio_dsp.h"
+#include "esp_log.h"
+#include "event_bus.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "memory_budget.h"
+#include "power.h"
+#include "radio_wazoo_config.h"
+#include <string.h>
+
+static const char *const TAG = "AUDIO_OUTPUT";
+
+#define AUDIO_TASK_STACK_SIZE 3072
+#define AUDIO_TASK_PRIORITY   (configMAX_PRIORITIES - 2)
+#define AUDIO_BUFFER_COUNT    2
+#define AUDIO_IDLE_TIMEOUT_MS 500 // no buffers for this long ends the stream and drops the PM lock
+#define AUDIO_BUFFER_BYTES    (AUDIO_OUTPUT_BLOCK_FRAMES * 2 * sizeof(int16_t))
+
+// Ping-pong buffers: the producer fills one half while the output task drains the other
+static int16_t *buffers[AUDIO_BUFFER_COUNT];
+static SemaphoreHandle_t free_buffers = NULL; // halves owned by the producer
+static QueueHandle_t ready_buffers = NULL;    // indices of halves ready for the sink
+static TaskHandle_t output_task = NULL;
+
+static const audio_sink_t *active_sink = NULL;
+static uint32_t device_rate = 0;
+static uint32_t source_rate = 0;
+static audio_resampler_t resampler;
+
+static int fill_index = 0;
+static size_t fill_frames = 0;
+static bool fill_owned = false;
+
+static volatile int32_t gain_q15 = 0;
+static uint8_t volume_percent = 0;
+
+static void stream_state_changed(bool active) {
+    esp_err_t ret = ESP_OK;
+    if (active) {
+        power_stream_begin();
+        if (active_sink->start != NULL) {
+            ret = active_sink->start();
+        }
+    } else {
+        if (active_sink->stop != NULL) {
+            ret = active_sink->stop();
+        }
+        power_stream_end();
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to %s sink '%s': %s", active ? "start" : "stop", active_sink->name,
+                 esp_err_to_name(ret));
+    }
+
+    event_stream_t event = {.active = active, .sample_rate = device_rate};
+    event_bus_publish_stream_state(&event);
+}
+
+static void audio_output_task(void *arg) {
+    bool streaming = false;
+    int index;
+
+    while (1) {
+        // Only a running stream needs the timeout; otherwise block so the CPU can sleep
+        TickType_t wait = streaming ? pdMS_TO_TICKS(AUDIO_IDLE_TIMEOUT_MS) : portMAX_DELAY;
+        if (xQueueReceive(ready_buffers, &index, wait) != pdTRUE) {
+            if (streaming) {
+                stream_state_changed(false);
+                streaming = false;
+            }
+            continue;
+        }
+        if (index < 0) {
+            break; // shutdown request
+        }
+        if (!streaming) {
+            stream_state_changed(true);
+            streaming = true;
+        }
+        if (active_sink->write(buffers[index], AUDIO_OUTPUT_BLOCK_FRAMES) != ESP_OK) {
+            ESP_LOGE(TAG, "Sink '%s' write failed", active_sink->name);
+        }
+        xSemaphoreGive(free_buffers);
+    }
+
+    if (streaming) {
+        stream_state_changed(false);
+    }
+    output_task = NULL;
+    vTaskDelete(NULL);
+}
+
+static void submit_fill_buffer(void) {
+    int16_t *buffer = buffers[fill_index];
+
+    // Short blocks are padded with silence so the sink always sees whole buffers
+    if (fill_frames < AUDIO_OUTPUT_BLOCK_FRAMES) {
+        memset(buffer + fill_frames * 2, 0, (AUDIO_OUTPUT_BLOCK_FRAMES - fill_frames) * 2 * sizeof(int16_t));
+    }
+    audio_scale_volume(buffer, AUDIO_OUTPUT_BLOCK_FRAMES * 2, gain_q15);
+
+    xQueueSend(ready_buffers, &fill_index, portMAX_DELAY);
+    fill_index ^= 1;
+    fill_frames = 0;
+    fill_owned = false;
+}
+
+esp_err_t audio_output_init(const audio_sink_t *sink, uint32_t sample_rate) {
+    if (sink == NULL || sample_rate == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (active_sink != NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    esp_err_t ret = sink->open(sample_rate);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to open sink '%s': %s", sink->name, esp_err_to_name(ret));
+        return ret;
+    }
+
+    // Internal RAM, not DMA-capable: i2s_channel_write() and dac_continuous_write() copy each block into
+    // the driver's own DMA descriptors, so DMA memory would only be taken away from WiFi and the drivers
+    for (int i = 0; i < AUDIO_BUFFER_COUNT; i++) {
+        buffers[i] = memory_budget_alloc(MEMORY_TAG_AUDIO, AUDIO_BUFFER_BYTES, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+        if (buffers[i] == NULL) {
+            ESP_LOGE(TAG, "Failed to allocate audio buffers");
+            ret = ESP_ERR_NO_MEM;
+            goto fail;
+        }
+    }
+
+    free_buffers = xSemaphoreCreateCounting(AUDIO_BUFFER_COUNT, AUDIO_BUFFER_COUNT);
+    ready_buffers = xQueueCreate(AUDIO_BUFFER_COUNT + 1, sizeof(int));
+    if (free_buffers == NULL || ready_buffers == NULL) {
+        ESP_LOGE(TAG, "Failed to allocate buffer queues");
+        ret = ESP_ERR_NO_MEM;
+        goto fail;
+    }
+
+    active_sink = sink;
+    device_rate = sample_rate;
+    source_rate = 0;
+    fill_index = 0;
+    fill_frames = 0;
+    fill_owned = false;
+    audio_output_set_volume(AUDIO_OUTPUT_VOLUME);
+
+    if (xTaskCreate(audio_output_task, "audio_out", AUDIO_TASK_STACK_SIZE, NULL, AUDIO_TASK_PRIORITY, &output_task) !=
+        pdPASS) {
+        ESP_LOGE(TAG, "Failed to create output task");
+        active_sink = NULL;
+        ret = ESP_ERR_NO_MEM;
+        goto fail;
+    }
+
+    ESP_LOGI(TAG, "Audio output started: sink '%s', %lu Hz, %d frames per buffer", sink->name,
+             (unsigned long)sample_rate, AUDIO_OUTPUT_BLOCK_FRAMES);
+    return ESP_OK;
+
+fail:
+    for (int i = 0; i < AUDIO_BUFFER_COUNT; i++) {
+        memory_budget_free(buffers[i]);
+        buffers[i] = NULL;
+    }
+    if (free_buffers != NULL) {
+        vSemaphoreDelete(free_buffers);
+        free_buffers = NULL;
+    }
+    if (ready_buffers != NULL) {
+        vQueueDelete(ready_buffers);
+        ready_buffers = NULL;
+    }
+    sink->close();
+    return ret;
+}
+
+esp_err_t audio_output_deinit(void) {
+    if (active_sink == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    audio_output_flush();
+    if (fill_owned) {
+        xSemaphoreGive(free_buffers); // empty half still held by the producer
+        fill_owned = false;
+    }
+
+    // Wait for both halves to come back, then stop the task
+    for (int i = 0; i < AUDIO_BUFFER_COUNT; i++) {
+        xSemaphoreTake(free_buffers, portMAX_DELAY);
+    }
+    int stop = -1;
+    xQueueSend(ready_buffers, &stop, portMAX_DELAY);
+    while (output_task != NULL) {
+        vTaskDelay(1);
+    }
+
+    esp_err_t ret = active_sink->close();
+    ESP_LOGI(TAG, "Audio output stopped: sink '%s'", active_sink->name);
+
+    vSemaphoreDelete(free_buffers);
+    vQueueDelete(ready_buffers);
+    for (int i = 0; i < AUDIO_BUFFER_COUNT; i++) {
+        memory_budget_free(buffers[i]);
+        buffers[i] = NULL;
+    }
+    free_buffers = NULL;
+    ready_buffers = NULL;
+    active_sink = NULL;
+
+    return ret;
+}
+
+esp_err_t audio_output_write(const int16_t *frames, size_t frame_count, uint32_t sample_rate) {
+    if (frames == NULL || sample_rate == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (active_sink == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (sample_rate != source_rate) {
+        audio_resampler_init(&resampler, sample_rate, device_rate);
+        source_rate = sample_rate;
+        ESP_LOGI(TAG, "Source rate %lu Hz -> device rate %lu Hz", (unsigned long)sample_rate,
+                 (unsigned long)device_rate);
+    }
+
+    while (frame_count > 0) {
+        if (!fill_owned) {
+            xSemaphoreTake(free_buffers, portMAX_DELAY);
+            fill_owned = true;
+        }
+
+        int16_t *dst = buffers[fill_index] + fill_frames * 2;
+        size_t room = AUDIO_OUTPUT_BLOCK_FRAMES - fill_frames;
+        size_t consumed, produced;
+
+        if (sample_rate == device_rate) {
+            produced = consumed = frame_count < room ? frame_count : room;
+            memcpy(dst, frames, produced * 2 * sizeof(int16_t));
+        } else {
+            produced = audio_resample(&resampler, frames, frame_count, dst, room, &consumed);
+        }
+
+        frames += consumed * 2;
+        frame_count -= consumed;
+        fill_frames += produced;
+
+        if (fill_frames == AUDIO_OUTPUT_BLOCK_FRAMES) {
+            submit_fill_buffer();
+        }
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t audio_output_flush(void) {
+    if (active_sink == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (fill_owned && fill_frames > 0) {
+        submit_fill_buffer();
+    }
+    return ESP_OK;
+}
+
+void audio_output_set_volume(uint8_t percent) {
+    if (percent > 100) {
+        percent = 100;
+    }
+    volume_percent = percent;
+    // Squared curve so the lower half of the range stays usable
+    gain_q15 = (int32_t)percent * percent * 32768 / 10000;
+}
+
+uint8_t audio_output_get_volume(void) {
+    return volume_percent;
+}
@@ -0,0 +1,89 @@
+#include "audio_output.h"
+#include "sdkconfig.h"
+#include "soc/soc_caps.h"
+
+#if SOC_DAC_SUPPORTED
+
+#include "driver/dac_continuous.h"
+#include "esp_log.h"
+#include "radio_wazoo_config.h"
+#include <stdbool.h>
+
+static const char *const TAG = "AUDIO_SINK_DAC";
+
+static dac_continuous_handle_t dac_handle = NULL;
+static bool enabled = false;
+static uint8_t dac_buffer[AUDIO_OUTPUT_BLOCK_FRAMES * 2];
+
+static esp_err_t dac_sink_open(uint32_t sample_rate) {
+    // Alternating mode interleaves L/R across both DAC channels, so the conversion clock runs at twice the rate
+    dac_continuous_config_t cfg = {
+        .chan_mask = DAC_CHANNEL_MASK_ALL,
+        .desc_num = 2,
+        .buf_size = sizeof(dac_buffer),
+        .freq_hz = sample_rate * 2,
+        .offset = 0,
+        .clk_src = DAC_DIGI_CLK_SRC_DEFAULT,
+        .chan_mode = DAC_CHANNEL_MODE_ALTER,
+    };
+
+    // Enabled per stream, like the I2S sink, so the driver's PM lock is not held while idle
+    esp_err_t ret = dac_continuous_new_channels(&cfg, &dac_handle);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create DAC channels: %s", esp_err_to_name(ret));
+    }
+    return ret;
+}
+
+static esp_err_t dac_sink_start(void) {
+    if (enabled) {
+        return ESP_OK;
+    }
+    esp_err_t ret = dac_continuous_enable(dac_handle);
+    enabled = ret == ESP_OK;
+    return ret;
+}
+
+static esp_err_t dac_sink_stop(void) {
+    if (!enabled) {
+        return ESP_OK;
+    }
+    enabled = false;
+    return dac_continuous_disable(dac_handle);
+}
+
+static esp_err_t dac_sink_write(const int16_t *frames, size_t frame_count) {
+    size_t samples = frame_count * 2;
+    if (samples > sizeof(dac_buffer)) {
+        samples = sizeof(dac_buffer);
+    }
+
+    // Signed 16-bit to unsigned 8-bit around the 128 midpoint
+    for (size_t i = 0; i < samples; i++) {
+        dac_buffer[i] = (uint8_t)((frames[i] >> 8) + 128);
+    }
+
+    size_t loaded = 0;
+    return dac_continuous_write(dac_handle, dac_buffer, samples, &loaded, -1);
+}
+
+static esp_err_t dac_sink_close(void) {
+    if (dac_handle == NULL) {
+        return ESP_OK;
+    }
+    dac_sink_stop();
+    esp_err_t ret = dac_continuous_del_channels(dac_handle);
+    dac_handle = NULL;
+    return ret;
+}
+
+const audio_sink_t audio_sink_dac = {
+    .name = "dac",
+    .open = dac_sink_open,
+    .start = dac_sink_start,
+    .write = dac_sink_write,
+    .stop = dac_sink_stop,
+    .close = dac_sink_close,
+};
+
+#endif // SOC_DAC_SUPPORTED
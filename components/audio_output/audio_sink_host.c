@@ -0,0 +1,108 @@
+#include "audio_output.h"
+#include "sdkconfig.h"
+
+static esp_err_t null_sink_open(uint32_t sample_rate) {
+    return ESP_OK;
+}
+
+static esp_err_t null_sink_write(const int16_t *frames, size_t frame_count) {
+    return ESP_OK;
+}
+
+static esp_err_t null_sink_close(void) {
+    return ESP_OK;
+}
+
+const audio_sink_t audio_sink_null = {
+    .name = "null",
+    .open = null_sink_open,
+    .write = null_sink_write,
+    .close = null_sink_close,
+};
+
+#if CONFIG_IDF_TARGET_LINUX
+
+#include "esp_log.h"
+#include "radio_wazoo_config.h"
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+static const char *const TAG = "AUDIO_SINK_WAV";
+
+#define WAV_HEADER_SIZE 44
+
+static FILE *wav_file = NULL;
+static uint32_t wav_rate = 0;
+static uint32_t wav_data_bytes = 0;
+
+static void put_le16(uint8_t *p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void put_le32(uint8_t *p, uint32_t v) {
+    put_le16(p, (uint16_t)v);
+    put_le16(p + 2, (uint16_t)(v >> 16));
+}
+
+static void write_wav_header(uint32_t sample_rate, uint32_t data_bytes) {
+    uint8_t header[WAV_HEADER_SIZE];
+
+    memcpy(header, "RIFF", 4);
+    put_le32(header + 4, 36 + data_bytes);
+    memcpy(header + 8, "WAVEfmt ", 8);
+    put_le32(header + 16, 16);              // fmt chunk size
+    put_le16(header + 20, 1);               // PCM
+    put_le16(header + 22, 2);               // channels
+    put_le32(header + 24, sample_rate);     // sample rate
+    put_le32(header + 28, sample_rate * 4); // byte rate
+    put_le16(header + 32, 4);               // block align
+    put_le16(header + 34, 16);              // bits per sample
+    memcpy(header + 36, "data", 4);
+    put_le32(header + 40, data_bytes);
+
+    fseek(wav_file, 0, SEEK_SET);
+    fwrite(header, 1, sizeof(header), wav_file);
+}
+
+static esp_err_t wav_sink_open(uint32_t sample_rate) {
+    wav_file = fopen(AUDIO_OUTPUT_WAV_PATH, "wb");
+    if (wav_file == NULL) {
+        ESP_LOGE(TAG, "Failed to open '%s': %s", AUDIO_OUTPUT_WAV_PATH, strerror(errno));
+        return ESP_FAIL;
+    }
+
+    wav_rate = sample_rate;
+    wav_data_bytes = 0;
+    write_wav_header(sample_rate, 0); // sizes are patched on close
+    ESP_LOGI(TAG, "Writing audio to '%s'", AUDIO_OUTPUT_WAV_PATH);
+    return ESP_OK;
+}
+
+static esp_err_t wav_sink_write(const int16_t *frames, size_t frame_count) {
+    // Host is little-endian, samples go out as-is
+    size_t written = fwrite(frames, 2 * sizeof(int16_t), frame_count, wav_file);
+    wav_data_bytes += written * 2 * sizeof(int16_t);
+    return written == frame_count ? ESP_OK : ESP_FAIL;
+}
+
+static esp_err_t wav_sink_close(void) {
+    if (wav_file == NULL) {
+        return ESP_OK;
+    }
+    write_wav_header(wav_rate, wav_data_bytes);
+    fclose(wav_file);
+    wav_file = NULL;
+    ESP_LOGI(TAG, "Closed '%s' (%lu data bytes)", AUDIO_OUTPUT_WAV_PATH, (unsigned long)wav_data_bytes);
+    return ESP_OK;
+}
+
+const audio_sink_t audio_sink_wav = {
+    .name = "wav",
+    .open = wav_sink_open,
+    .write = wav_sink_write,
+    .close = wav_sink_close,
+};
+
+#endif // CONFIG_IDF_TARGET_LINUX
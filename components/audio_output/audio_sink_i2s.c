@@ -0,0 +1,101 @@
+#include "audio_output.h"
+#include "sdkconfig.h"
+#include "soc/soc_caps.h"
+
+#if SOC_I2S_SUPPORTED
+
+#include "driver/i2s_std.h"
+#include "esp_log.h"
+#include "radio_wazoo_config.h"
+#include <stdbool.h>
+
+static const char *const TAG = "AUDIO_SINK_I2S";
+
+static i2s_chan_handle_t tx_chan = NULL;
+static bool enabled = false;
+
+static esp_err_t i2s_sink_open(uint32_t sample_rate) {
+    // Two DMA descriptors of one output block each: the driver ping-pongs them while we fill the next block
+    i2s_chan_config_t chan_cfg = I2S_CHANNEL_DEFAULT_CONFIG(I2S_NUM_AUTO, I2S_ROLE_MASTER);
+    chan_cfg.dma_desc_num = 2;
+    chan_cfg.dma_frame_num = AUDIO_OUTPUT_BLOCK_FRAMES;
+    chan_cfg.auto_clear = true;
+
+    esp_err_t ret = i2s_new_channel(&chan_cfg, &tx_chan, NULL);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create I2S channel: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    i2s_std_config_t std_cfg = {
+        .clk_cfg = I2S_STD_CLK_DEFAULT_CONFIG(sample_rate),
+        .slot_cfg = I2S_STD_PHILIPS_SLOT_DEFAULT_CONFIG(I2S_DATA_BIT_WIDTH_16BIT, I2S_SLOT_MODE_STEREO),
+        .gpio_cfg =
+            {
+                .mclk = I2S_GPIO_UNUSED,
+                .bclk = AUDIO_I2S_BCLK_GPIO,
+                .ws = AUDIO_I2S_WS_GPIO,
+                .dout = AUDIO_I2S_DOUT_GPIO,
+                .din = I2S_GPIO_UNUSED,
+                .invert_flags =
+                    {
+                        .mclk_inv = false,
+                        .bclk_inv = false,
+                        .ws_inv = false,
+                    },
+            },
+    };
+
+    // Left disabled until a stream starts: an enabled channel holds the driver's APB PM lock
+    ret = i2s_channel_init_std_mode(tx_chan, &std_cfg);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to configure I2S channel: %s", esp_err_to_name(ret));
+        i2s_del_channel(tx_chan);
+        tx_chan = NULL;
+    }
+
+    return ret;
+}
+
+static esp_err_t i2s_sink_start(void) {
+    if (enabled) {
+        return ESP_OK;
+    }
+    esp_err_t ret = i2s_channel_enable(tx_chan);
+    enabled = ret == ESP_OK;
+    return ret;
+}
+
+static esp_err_t i2s_sink_stop(void) {
+    if (!enabled) {
+        return ESP_OK;
+    }
+    enabled = false;
+    return i2s_channel_disable(tx_chan);
+}
+
+static esp_err_t i2s_sink_write(const int16_t *frames, size_t frame_count) {
+    size_t written = 0;
+    return i2s_channel_write(tx_chan, frames, frame_count * 2 * sizeof(int16_t), &written, portMAX_DELAY);
+}
+
+static esp_err_t i2s_sink_close(void) {
+    if (tx_chan == NULL) {
+        return ESP_OK;
+    }
+    i2s_sink_stop();
+    esp_err_t ret = i2s_del_channel(tx_chan);
+    tx_chan = NULL;
+    return ret;
+}
+
+const audio_sink_t audio_sink_i2s = {
+    .name = "i2s",
+    .open = i2s_sink_open,
+    .start = i2s_sink_start,
+    .write = i2s_sink_write,
+    .stop = i2s_sink_stop,
+    .close = i2s_sink_close,
+};
+
+#endif // SOC_I2S_SUPPORTED
@@ -0,0 +1,104 @@
+#ifndef AUDIO_OUTPUT_H
+#define AUDIO_OUTPUT_H
+
+#include "esp_err.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Audio sink interface
+ *
+ * Sinks consume interleaved stereo 16-bit frames at the device sample rate.
+ * write() may block until the sink has room for the whole block.
+ * start() and stop() (optional) bracket each stream: hardware sinks only
+ * run their peripheral, and hold its PM lock, in between.
+ */
+typedef struct {
+    const char *name;
+    esp_err_t (*open)(uint32_t sample_rate);
+    esp_err_t (*start)(void);
+    esp_err_t (*write)(const int16_t *frames, size_t frame_count);
+    esp_err_t (*stop)(void);
+    esp_err_t (*close)(void);
+} audio_sink_t;
+
+/** External I2S DAC (pins in radio_wazoo_config.h), available where the SoC has I2S */
+extern const audio_sink_t audio_sink_i2s;
+
+/** Internal 8-bit DAC, available on ESP32 and ESP32-S2 */
+extern const audio_sink_t audio_sink_dac;
+
+/** WAV file writer, available on the linux target */
+extern const audio_sink_t audio_sink_wav;
+
+/** Discards all samples, available everywhere */
+extern const audio_sink_t audio_sink_null;
+
+/**
+ * @brief Open the sink and start the output task
+ *
+ * @param sink Sink to write to
+ * @param sample_rate Device sample rate in Hz
+ * @return esp_err_t ESP_OK on success
+ */
+esp_err_t audio_output_init(const audio_sink_t *sink, uint32_t sample_rate);
+
+/**
+ * @brief Stop the output task and close the sink
+ *
+ * @return esp_err_t ESP_OK on success
+ */
+esp_err_t audio_output_deinit(void);
+
+/**
+ * @brief Queue interleaved stereo frames for playback
+ *
+ * Frames are resampled to the device rate and volume-scaled into the
+ * double buffer. Blocks while both buffer halves are owned by the sink.
+ * Must be called from a single producer task.
+ *
+ * @param frames Interleaved stereo samples
+ * @param frame_count Number of stereo frames
+ * @param sample_rate Source sample rate in Hz (e.g. 44100 or 48000)
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_STATE if not initialized
+ */
+esp_err_t audio_output_write(const int16_t *frames, size_t frame_count, uint32_t sample_rate);
+
+/**
+ * @brief Hand a partially filled buffer to the sink
+ *
+ * @return esp_err_t ESP_OK on success
+ */
+esp_err_t audio_output_flush(void);
+
+/**
+ * @brief Set output volume
+ *
+ * @param percent Volume 0-100
+ */
+void audio_output_set_volume(uint8_t percent);
+
+/**
+ * @brief Get output volume
+ *
+ * @return uint8_t Volume 0-100
+ */
+uint8_t audio_output_get_volume(void);
+
+/**
+ * @brief Log CPU cycles per 1024 frames for each output stage
+ *
+ * Runs resampling, volume scaling and a null sink write on synthetic data.
+ * Does not touch the active sink.
+ */
+void audio_output_benchmark(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // AUDIO_OUTPUT_H
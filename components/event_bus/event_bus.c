@@ -0,0 +1,317 @@
+#include "event_bus.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/task.h"
+#include "radio_wazoo_config.h"
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+
+static const char *const TAG = "EVENT_BUS";
+
+_Static_assert(EVENT_BUS_POOL_SIZE <= 32, "the pool free map is 32 bits");
+_Static_assert((EVENT_BUS_QUEUE_DEPTH & (EVENT_BUS_QUEUE_DEPTH - 1)) == 0,
+               "EVENT_BUS_QUEUE_DEPTH must be a power of two");
+_Static_assert(EVENT_MAX <= 32, "event masks are 32 bits");
+
+static const char *const event_names[EVENT_MAX] = {
+#define EVENT_BUS_NAME(id, member, type) #member,
+    EVENT_BUS_EVENTS(EVENT_BUS_NAME)
+#undef EVENT_BUS_NAME
+};
+
+static const size_t payload_sizes[EVENT_MAX] = {
+#define EVENT_BUS_SIZE(id, member, type) sizeof(type),
+    EVENT_BUS_EVENTS(EVENT_BUS_SIZE)
+#undef EVENT_BUS_SIZE
+};
+
+/**
+ * Bounded MPSC ring of pool indices (Vyukov). Each cell carries a sequence
+ * number that tells producers and consumers whether it is theirs to use, so
+ * push and pop are a single CAS on the position with no lock.
+ */
+typedef struct {
+    atomic_uint sequence;
+    uint8_t index;
+} ring_cell_t;
+
+typedef struct {
+    ring_cell_t *cells;
+    unsigned mask;
+    atomic_uint enqueue_pos;
+    atomic_uint dequeue_pos;
+} ring_t;
+
+static void ring_init(ring_t *ring, ring_cell_t *cells, unsigned size) {
+    ring->cells = cells;
+    ring->mask = size - 1;
+    for (unsigned i = 0; i < size; i++) {
+        atomic_init(&cells[i].sequence, i);
+    }
+    atomic_init(&ring->enqueue_pos, 0);
+    atomic_init(&ring->dequeue_pos, 0);
+}
+
+static bool ring_push(ring_t *ring, uint8_t index) {
+    unsigned pos = atomic_load_explicit(&ring->enqueue_pos, memory_order_relaxed);
+    ring_cell_t *cell;
+
+    for (;;) {
+        cell = &ring->cells[pos & ring->mask];
+        unsigned seq = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+        int diff = (int)(seq - pos);
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&ring->enqueue_pos, &pos, pos + 1, memory_order_relaxed,
+                                                      memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return false; // full
+        } else {
+            pos = atomic_load_explicit(&ring->enqueue_pos, memory_order_relaxed);
+        }
+    }
+
+    cell->index = index;
+    atomic_store_explicit(&cell->sequence, pos + 1, memory_order_release);
+    return true;
+}
+
+static bool ring_pop(ring_t *ring, uint8_t *index) {
+    unsigned pos = atomic_load_explicit(&ring->dequeue_pos, memory_order_relaxed);
+    ring_cell_t *cell;
+
+    for (;;) {
+        cell = &ring->cells[pos & ring->mask];
+        unsigned seq = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+        int diff = (int)(seq - (pos + 1));
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&ring->dequeue_pos, &pos, pos + 1, memory_order_relaxed,
+                                                      memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return false; // empty
+        } else {
+            pos = atomic_load_explicit(&ring->dequeue_pos, memory_order_relaxed);
+        }
+    }
+
+    *index = cell->index;
+    atomic_store_explicit(&cell->sequence, pos + ring->mask + 1, memory_order_release);
+    return true;
+}
+
+typedef struct {
+    event_t event;
+    atomic_uint refs; // subscribers still holding the event, plus the publisher while it fans out
+} pool_entry_t;
+
+struct event_bus_subscriber {
+    const char *name;
+    uint32_t mask;
+    ring_t queue;
+    ring_cell_t cells[EVENT_BUS_QUEUE_DEPTH];
+    _Atomic(TaskHandle_t) waiter;
+    atomic_uint received;
+    atomic_uint dropped;
+};
+
+// A bit per free entry. A ring would be the obvious free list, but a popper
+// preempted mid-pop makes a Vyukov ring report full and the entry would leak.
+static pool_entry_t pool[EVENT_BUS_POOL_SIZE];
+static atomic_uint free_map;
+
+static event_bus_subscriber_t subscribers[EVENT_BUS_MAX_SUBSCRIBERS];
+static atomic_uint subscriber_count;
+static portMUX_TYPE subscribe_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static atomic_uint published[EVENT_MAX];
+static atomic_uint pool_exhausted;
+static bool initialized = false;
+
+static bool pool_take(uint8_t *index) {
+    unsigned map = atomic_load_explicit(&free_map, memory_order_relaxed);
+
+    while (map != 0) {
+        unsigned bit = (unsigned)__builtin_ctz(map);
+        if (atomic_compare_exchange_weak_explicit(&free_map, &map, map & ~(1u << bit), memory_order_acquire,
+                                                  memory_order_relaxed)) {
+            *index = (uint8_t)bit;
+            return true;
+        }
+    }
+    return false;
+}
+
+static void release(uint8_t index) {
+    if (atomic_fetch_sub_explicit(&pool[index].refs, 1, memory_order_acq_rel) == 1) {
+        atomic_fetch_or_explicit(&free_map, 1u << index, memory_order_release);
+    }
+}
+
+esp_err_t event_bus_init(void) {
+    if (initialized) {
+        return ESP_OK;
+    }
+
+    for (unsigned i = 0; i < EVENT_BUS_POOL_SIZE; i++) {
+        atomic_init(&pool[i].refs, 0);
+    }
+    atomic_store(&free_map, EVENT_BUS_POOL_SIZE == 32 ? UINT32_MAX : (1u << EVENT_BUS_POOL_SIZE) - 1);
+    initialized = true;
+
+    ESP_LOGI(TAG, "Event bus initialized (%d events, pool %d, queue depth %d)", EVENT_MAX, EVENT_BUS_POOL_SIZE,
+             EVENT_BUS_QUEUE_DEPTH);
+    return ESP_OK;
+}
+
+event_bus_subscriber_t *event_bus_subscribe(const char *name, uint32_t mask) {
+    event_bus_subscriber_t *sub = NULL;
+
+    taskENTER_CRITICAL(&subscribe_lock);
+    unsigned count = atomic_load_explicit(&subscriber_count, memory_order_relaxed);
+    if (count < EVENT_BUS_MAX_SUBSCRIBERS) {
+        sub = &subscribers[count];
+        sub->name = name;
+        sub->mask = mask;
+        ring_init(&sub->queue, sub->cells, EVENT_BUS_QUEUE_DEPTH);
+        atomic_init(&sub->waiter, NULL);
+        atomic_init(&sub->received, 0);
+        atomic_init(&sub->dropped, 0);
+        // Publishers only look at slots below the count, so publish the slot once it is complete
+        atomic_store_explicit(&subscriber_count, count + 1, memory_order_release);
+    }
+    taskEXIT_CRITICAL(&subscribe_lock);
+
+    if (sub == NULL) {
+        ESP_LOGE(TAG, "No free subscriber slot for %s", name);
+    } else {
+        ESP_LOGI(TAG, "Subscriber %s registered (mask 0x%08lx)", name, (unsigned long)mask);
+    }
+    return sub;
+}
+
+bool event_bus_publish(event_id_t id, const void *payload, size_t size) {
+    if (id >= EVENT_MAX || size != payload_sizes[id] || !initialized) {
+        return false;
+    }
+
+    atomic_fetch_add_explicit(&published[id], 1, memory_order_relaxed);
+
+    unsigned count = atomic_load_explicit(&subscriber_count, memory_order_acquire);
+    unsigned interested = 0;
+    for (unsigned i = 0; i < count; i++) {
+        if (subscribers[i].mask & EVENT_MASK(id)) {
+            interested++;
+        }
+    }
+    if (interested == 0) {
+        return true;
+    }
+
+    uint8_t index;
+    if (!pool_take(&index)) {
+        atomic_fetch_add_explicit(&pool_exhausted, 1, memory_order_relaxed);
+        return false;
+    }
+
+    pool_entry_t *entry = &pool[index];
+    entry->event.id = id;
+    entry->event.timestamp_us = esp_timer_get_time();
+    memcpy(&entry->event.station_joined, payload, size); // all members start at the union
+    atomic_store_explicit(&entry->refs, interested + 1, memory_order_relaxed);
+
+    bool delivered = true;
+    for (unsigned i = 0; i < count; i++) {
+        event_bus_subscriber_t *sub = &subscribers[i];
+        if (!(sub->mask & EVENT_MASK(id))) {
+            continue;
+        }
+
+        if (!ring_push(&sub->queue, index)) {
+            atomic_fetch_add_explicit(&sub->dropped, 1, memory_order_relaxed);
+            release(index);
+            delivered = false;
+            continue;
+        }
+
+        // Pairs with the fence in event_bus_receive: either we see the waiter or it sees the event
+        atomic_thread_fence(memory_order_seq_cst);
+        TaskHandle_t waiter = atomic_load_explicit(&sub->waiter, memory_order_relaxed);
+        if (waiter != NULL) {
+            xTaskNotifyGive(waiter);
+        }
+    }
+
+    release(index);
+    return delivered;
+}
+
+bool event_bus_receive(event_bus_subscriber_t *sub, event_t *event, TickType_t timeout) {
+    uint8_t index;
+    TimeOut_t deadline;
+
+    vTaskSetTimeOutState(&deadline);
+    atomic_store_explicit(&sub->waiter, xTaskGetCurrentTaskHandle(), memory_order_relaxed);
+
+    for (;;) {
+        atomic_thread_fence(memory_order_seq_cst);
+        if (ring_pop(&sub->queue, &index)) {
+            *event = pool[index].event;
+            release(index);
+            atomic_fetch_add_explicit(&sub->received, 1, memory_order_relaxed);
+            return true;
+        }
+
+        // A notification left over from an event already drained wakes us early; look again, but only for
+        // what is left of the timeout (xTaskCheckForTimeOut shrinks it, and never expires portMAX_DELAY)
+        if (xTaskCheckForTimeOut(&deadline, &timeout) != pdFALSE) {
+            return false;
+        }
+        ulTaskNotifyTake(pdTRUE, timeout);
+    }
+}
+
+const char *event_bus_name(event_id_t id) {
+    return id < EVENT_MAX ? event_names[id] : "unknown";
+}
+
+static bool __attribute__((format(printf, 4, 5)))
+append(char *buffer, size_t buffer_size, size_t *len, const char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    int n = vsnprintf(buffer + *len, buffer_size - *len, fmt, args);
+    va_end(args);
+    if (n < 0 || (size_t)n >= buffer_size - *len) {
+        return false;
+    }
+    *len += n;
+    return true;
+}
+
+size_t event_bus_to_json(char *buffer, size_t buffer_size) {
+    size_t len = 0;
+    bool ok = append(buffer, buffer_size, &len, "{\"published\":{");
+
+    for (int i = 0; i < EVENT_MAX && ok; i++) {
+        ok = append(buffer, buffer_size, &len, "%s\"%s\":%u", i ? "," : "", event_names[i],
+                    atomic_load_explicit(&published[i], memory_order_relaxed));
+    }
+
+    ok = ok && append(buffer, buffer_size, &len, "},\"pool_exhausted\":%u,\"subscribers\":[",
+                      atomic_load_explicit(&pool_exhausted, memory_order_relaxed));
+
+    unsigned count = atomic_load_explicit(&subscriber_count, memory_order_acquire);
+    for (unsigned i = 0; i < count && ok; i++) {
+        event_bus_subscriber_t *sub = &subscribers[i];
+        ok = append(buffer, buffer_size, &len, "%s{\"name\":\"%s\",\"received\":%u,\"dropped\":%u}", i ? "," : "",
+                    sub->name, atomic_load_explicit(&sub->received, memory_order_relaxed),
+                    atomic_load_explicit(&sub->dropped, memory_order_relaxed));
+    }
+
+    ok = ok && append(buffer, buffer_size, &len, "]}");
+    return ok ? len : 0;
+}
@@ -0,0 +1,99 @@
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "event_bus.h"
+#include "freertos/task.h"
+
+static const char *const TAG = "EVENT_BUS_BENCH";
+
+#define BENCH_TASK_STACK_SIZE 3072
+#define BENCH_TASK_PRIORITY   5
+#define BENCH_PUBLISH_RETRIES 1000 // ticks to wait for queue space before giving up on the run
+
+typedef struct {
+    uint32_t count;
+    uint32_t received;
+    uint32_t out_of_order;
+    int64_t latency_total_us;
+    int64_t latency_max_us;
+    TaskHandle_t producer;
+    volatile bool consumer_done;
+} bench_state_t;
+
+static event_bus_subscriber_t *bench_sub = NULL;
+
+static void bench_consumer_task(void *arg) {
+    bench_state_t *state = (bench_state_t *)arg;
+    event_t event;
+
+    while (state->received < state->count) {
+        if (!event_bus_receive(bench_sub, &event, pdMS_TO_TICKS(1000))) {
+            break; // producer gave up
+        }
+        int64_t latency = esp_timer_get_time() - event.timestamp_us;
+        state->latency_total_us += latency;
+        if (latency > state->latency_max_us) {
+            state->latency_max_us = latency;
+        }
+        if (event.benchmark.sequence != state->received) {
+            state->out_of_order++;
+        }
+        state->received++;
+    }
+
+    state->consumer_done = true;
+    xTaskNotifyGive(state->producer);
+    vTaskDelete(NULL);
+}
+
+bool event_bus_benchmark(uint32_t count) {
+    if (bench_sub == NULL) {
+        bench_sub = event_bus_subscribe("benchmark", EVENT_MASK(EVENT_BENCHMARK));
+        if (bench_sub == NULL) {
+            return false;
+        }
+    }
+
+    bench_state_t state = {.count = count, .producer = xTaskGetCurrentTaskHandle()};
+    if (xTaskCreate(bench_consumer_task, "bus_bench", BENCH_TASK_STACK_SIZE, &state, BENCH_TASK_PRIORITY, NULL) !=
+        pdPASS) {
+        ESP_LOGE(TAG, "Failed to create consumer task");
+        return false;
+    }
+
+    uint32_t retries = 0;
+    uint32_t published = 0;
+    int64_t start = esp_timer_get_time();
+    while (published < count) {
+        event_benchmark_t payload = {.sequence = published};
+        // A full queue drops the event; back off and send the same sequence again, unless nobody is draining it
+        uint32_t attempts = 0;
+        bool sent;
+        while (!(sent = event_bus_publish_benchmark(&payload)) && !state.consumer_done &&
+               attempts < BENCH_PUBLISH_RETRIES) {
+            attempts++;
+            vTaskDelay(1);
+        }
+        retries += attempts;
+        if (!sent) {
+            ESP_LOGW(TAG, "Consumer stopped draining, giving up after %lu of %lu events", (unsigned long)published,
+                     (unsigned long)count);
+            break;
+        }
+        published++;
+    }
+    int64_t publish_us = esp_timer_get_time() - start;
+
+    // The consumer always reports back, at the latest one receive timeout after the last event
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    int64_t total_us = esp_timer_get_time() - start;
+
+    ESP_LOGI(TAG, "%lu events: publish %lld us, end-to-end %lld us (%lld events/s), %lu retries",
+             (unsigned long)published, (long long)publish_us, (long long)total_us,
+             total_us > 0 ? published * 1000000LL / total_us : 0LL, (unsigned long)retries);
+    ESP_LOGI(TAG, "latency avg/max: %lld/%lld us, received %lu, out of order %lu",
+             (long long)(state.received > 0 ? state.latency_total_us / state.received : 0),
+             (long long)state.latency_max_us,
+             (unsigned long)state.received, (unsigned long)state.out_of_order);
+
+    return published == count && state.received == count && state.out_of_order == 0;
+}
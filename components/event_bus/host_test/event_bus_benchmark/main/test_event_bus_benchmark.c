@@ -0,0 +1,128 @@
+#include "../../../event_bus.c"
+#include "freertos/semphr.h"
+#include "unity.h"
+#include <stdlib.h>
+
+#define BENCH_EVENTS     20000
+#define PRODUCERS        4
+#define PRODUCER_EVENTS  50000
+#define RECEIVE_TIMEOUT  pdMS_TO_TICKS(5000)
+
+#define FULL_POOL (EVENT_BUS_POOL_SIZE == 32 ? UINT32_MAX : (1u << EVENT_BUS_POOL_SIZE) - 1)
+
+typedef struct {
+    unsigned id;
+    SemaphoreHandle_t done;
+} producer_t;
+
+static producer_t producers[PRODUCERS];
+static uint8_t seen[PRODUCERS][PRODUCER_EVENTS];
+static atomic_uint producer_retries;
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+static event_bus_subscriber_t *find_subscriber(const char *name) {
+    for (unsigned i = 0; i < atomic_load(&subscriber_count); i++) {
+        if (strcmp(subscribers[i].name, name) == 0) {
+            return &subscribers[i];
+        }
+    }
+    return NULL;
+}
+
+static void assert_drained(event_bus_subscriber_t *sub) {
+    uint8_t index;
+    TEST_ASSERT_FALSE_MESSAGE(ring_pop(&sub->queue, &index), "events left in the queue");
+    TEST_ASSERT_EQUAL_HEX32_MESSAGE(FULL_POOL, atomic_load(&free_map), "pool entries not returned");
+}
+
+static void test_benchmark_delivers_every_event_once(void) {
+    TEST_ASSERT_TRUE(event_bus_benchmark(BENCH_EVENTS));
+
+    event_bus_subscriber_t *sub = find_subscriber("benchmark");
+    TEST_ASSERT_NOT_NULL(sub);
+    TEST_ASSERT_EQUAL_UINT32(BENCH_EVENTS, atomic_load(&sub->received));
+    // Every attempt is counted as published; the retried ones were dropped, never delivered twice
+    TEST_ASSERT_EQUAL_UINT32(BENCH_EVENTS + atomic_load(&sub->dropped) + atomic_load(&pool_exhausted),
+                             atomic_load(&published[EVENT_BENCHMARK]));
+    assert_drained(sub);
+}
+
+// Payload: producer in the top byte, sequence below; a dropped event is sent again, so each arrives exactly once
+static void producer_task(void *arg) {
+    producer_t *producer = (producer_t *)arg;
+
+    for (uint32_t seq = 0; seq < PRODUCER_EVENTS; seq++) {
+        event_file_t payload = {.size = (producer->id << 24) | seq};
+        snprintf(payload.path, sizeof(payload.path), "/stress/%u", producer->id);
+        while (!event_bus_publish_file_written(&payload)) {
+            atomic_fetch_add(&producer_retries, 1);
+            taskYIELD();
+        }
+    }
+
+    xSemaphoreGive(producer->done);
+    vTaskDelete(NULL);
+}
+
+static void test_four_producers_exactly_once(void) {
+    event_bus_subscriber_t *sub = event_bus_subscribe("stress", EVENT_MASK(EVENT_FILE_WRITTEN));
+    event_bus_subscriber_t *other = event_bus_subscribe("other", EVENT_MASK(EVENT_STREAM_STATE));
+    TEST_ASSERT_NOT_NULL(sub);
+    TEST_ASSERT_NOT_NULL(other);
+
+    memset(seen, 0, sizeof(seen));
+    atomic_store(&producer_retries, 0);
+    for (unsigned p = 0; p < PRODUCERS; p++) {
+        producers[p].id = p;
+        producers[p].done = xSemaphoreCreateBinary();
+        TEST_ASSERT_NOT_NULL(producers[p].done);
+        TEST_ASSERT_EQUAL(pdPASS, xTaskCreate(producer_task, "producer", 4096, &producers[p],
+                                              uxTaskPriorityGet(NULL), NULL));
+    }
+
+    uint32_t next[PRODUCERS] = {0};
+    int64_t start = esp_timer_get_time();
+    for (uint32_t n = 0; n < PRODUCERS * PRODUCER_EVENTS; n++) {
+        event_t event;
+        TEST_ASSERT_TRUE_MESSAGE(event_bus_receive(sub, &event, RECEIVE_TIMEOUT), "event lost");
+        TEST_ASSERT_EQUAL(EVENT_FILE_WRITTEN, event.id);
+
+        unsigned p = event.file_written.size >> 24;
+        uint32_t seq = event.file_written.size & 0xFFFFFF;
+        TEST_ASSERT_LESS_THAN(PRODUCERS, p);
+        TEST_ASSERT_LESS_THAN(PRODUCER_EVENTS, seq);
+        TEST_ASSERT_EQUAL_MESSAGE(0, seen[p][seq], "event delivered twice");
+        seen[p][seq] = 1;
+        // One ring per subscriber keeps each producer's events in order
+        TEST_ASSERT_EQUAL_UINT32(next[p], seq);
+        next[p]++;
+    }
+    int64_t elapsed_us = esp_timer_get_time() - start;
+
+    for (unsigned p = 0; p < PRODUCERS; p++) {
+        TEST_ASSERT_TRUE(xSemaphoreTake(producers[p].done, RECEIVE_TIMEOUT));
+        vSemaphoreDelete(producers[p].done);
+        TEST_ASSERT_EQUAL_UINT32(PRODUCER_EVENTS, next[p]);
+    }
+
+    TEST_ASSERT_EQUAL_UINT32(PRODUCERS * PRODUCER_EVENTS, atomic_load(&sub->received));
+    TEST_ASSERT_EQUAL_UINT32(0, atomic_load(&other->received));
+    assert_drained(sub);
+
+    char line[96];
+    snprintf(line, sizeof(line), "%u events from %u producers in %lld us, %u retries", PRODUCERS * PRODUCER_EVENTS,
+             PRODUCERS, (long long)elapsed_us, atomic_load(&producer_retries));
+    TEST_MESSAGE(line);
+}
+
+void app_main(void) {
+    ESP_ERROR_CHECK(event_bus_init());
+
+    UNITY_BEGIN();
+    RUN_TEST(test_benchmark_delivers_every_event_once);
+    RUN_TEST(test_four_producers_exactly_once);
+    exit(UNITY_END());
+}
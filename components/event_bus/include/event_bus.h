@@ -0,0 +1,157 @@
+#ifndef EVENT_BUS_H
+#define EVENT_BUS_H
+
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define EVENT_PATH_MAX 64
+#define EVENT_KEY_MAX  16
+
+typedef struct {
+    uint8_t mac[6];
+    uint8_t aid;
+} event_station_t;
+
+typedef struct {
+    char key[EVENT_KEY_MAX];
+} event_setting_t;
+
+typedef struct {
+    char path[EVENT_PATH_MAX];
+    size_t size; // bytes written, 0 for deletions
+} event_file_t;
+
+typedef struct {
+    bool active;
+    uint32_t sample_rate;
+} event_stream_t;
+
+typedef struct {
+    uint32_t sequence;
+} event_benchmark_t;
+
+/**
+ * Compile-time event registry: X(ID, member, payload type).
+ * Adding an entry creates EVENT_<ID>, an event_t union member and a typed
+ * event_bus_publish_<member>() helper.
+ */
+#define EVENT_BUS_EVENTS(X)                               \
+    X(STATION_JOINED, station_joined, event_station_t)    \
+    X(STATION_LEFT, station_left, event_station_t)        \
+    X(SETTING_CHANGED, setting_changed, event_setting_t)  \
+    X(FILE_WRITTEN, file_written, event_file_t)           \
+    X(FILE_DELETED, file_deleted, event_file_t)           \
+    X(STREAM_STATE, stream_state, event_stream_t)         \
+    X(BENCHMARK, benchmark, event_benchmark_t)
+
+typedef enum {
+#define EVENT_BUS_ID(id, member, type) EVENT_##id,
+    EVENT_BUS_EVENTS(EVENT_BUS_ID)
+#undef EVENT_BUS_ID
+    EVENT_MAX,
+} event_id_t;
+
+#define EVENT_MASK(id) (1u << (id))
+
+typedef struct {
+    event_id_t id;
+    int64_t timestamp_us; // esp_timer time at publish
+    union {
+#define EVENT_BUS_MEMBER(id, member, type) type member;
+        EVENT_BUS_EVENTS(EVENT_BUS_MEMBER)
+#undef EVENT_BUS_MEMBER
+    };
+} event_t;
+
+typedef struct event_bus_subscriber event_bus_subscriber_t;
+
+/**
+ * @brief Initialize the event pool
+ *
+ * @return esp_err_t ESP_OK on success
+ */
+esp_err_t event_bus_init(void);
+
+/**
+ * @brief Register a subscriber
+ *
+ * Call during initialization. The queue starts buffering immediately; the
+ * first task that calls event_bus_receive() becomes the one woken up (via its
+ * task notification value, which it must not use for anything else).
+ *
+ * @param name Subscriber name for statistics
+ * @param mask Events of interest, EVENT_MASK() values or'ed together
+ * @return event_bus_subscriber_t* Subscriber, NULL if all slots are taken
+ */
+event_bus_subscriber_t *event_bus_subscribe(const char *name, uint32_t mask);
+
+/**
+ * @brief Publish an event to every interested subscriber
+ *
+ * Lock-free and allocation-free. Use the typed event_bus_publish_<member>()
+ * helpers instead of calling this directly.
+ *
+ * @param id Event ID
+ * @param payload Payload matching the registry type for id
+ * @param size Payload size
+ * @return bool false if the event was dropped for at least one subscriber
+ */
+bool event_bus_publish(event_id_t id, const void *payload, size_t size);
+
+#define EVENT_BUS_PUBLISHER(id, member, type)                              \
+    static inline bool event_bus_publish_##member(const type *payload) {   \
+        return event_bus_publish(EVENT_##id, payload, sizeof(*payload));   \
+    }
+EVENT_BUS_EVENTS(EVENT_BUS_PUBLISHER)
+#undef EVENT_BUS_PUBLISHER
+
+/**
+ * @brief Take the next event for a subscriber
+ *
+ * @param sub Subscriber
+ * @param event Receives a copy of the event
+ * @param timeout Total ticks to wait when the queue is empty, however often the task is woken
+ * @return bool true if an event was received
+ */
+bool event_bus_receive(event_bus_subscriber_t *sub, event_t *event, TickType_t timeout);
+
+/**
+ * @brief Get event name for logging
+ *
+ * @param id Event ID
+ * @return const char* Name
+ */
+const char *event_bus_name(event_id_t id);
+
+/**
+ * @brief Render per-event and per-subscriber counters as JSON
+ *
+ * @param buffer Output buffer
+ * @param buffer_size Size of buffer
+ * @return size_t JSON length, 0 if the buffer was too small
+ */
+size_t event_bus_to_json(char *buffer, size_t buffer_size);
+
+/**
+ * @brief Measure publish throughput and publish-to-receive latency
+ *
+ * Runs a consumer task on a dedicated subscriber and logs the results. Gives
+ * up early if the consumer stops draining its queue.
+ *
+ * @param count Number of events to publish
+ * @return bool true if all count events arrived, each once and in order
+ */
+bool event_bus_benchmark(uint32_t count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // EVENT_BUS_H
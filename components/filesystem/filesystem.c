@@ -1,8 +1,16 @@
 #include "filesystem.h"
-#include "esp_littlefs.h"
 #include "esp_log.h"
+#include "esp_timer.h"
+#include "event_bus.h"
+#include "filesystem_lfs.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "nvs.h"
 #include "radio_wazoo_config.h"
+#include "trace.h"
 #include <errno.h>
+#include <stdarg.h>
 #include <stdio.h>
 #include <string.h>
 #include <sys/stat.h>
@@ -10,21 +18,201 @@
 
 static const char *const TAG = "FILESYSTEM";
 
+#define FS_STATS_PATH_MAX           64
+#define FS_TMP_PATH_MAX             260 // make_parent_dirs() limit plus ".tmp"
+#define FS_WEAR_NVS_KEY             "fs_wear"
+#define MAINTENANCE_TASK_STACK_SIZE 4096 // nvs_commit goes through the flash driver
+#define MAINTENANCE_TASK_PRIORITY   1 // only runs when everything else is idle
+
+typedef struct {
+    char path[FS_STATS_PATH_MAX];
+    uint32_t writes;
+    uint32_t bytes;
+} path_stats_t;
+
+typedef struct {
+    uint32_t uptime;
+    uint32_t used;
+} usage_sample_t;
+
+static SemaphoreHandle_t stats_lock = NULL;
+static TaskHandle_t maintenance_task_handle = NULL;
+static path_stats_t paths[FILESYSTEM_STATS_MAX_PATHS];
+static uint32_t untracked_writes = 0; // writes of paths evicted from the table
+static usage_sample_t history[FILESYSTEM_HISTORY_SIZE];
+static size_t history_head = 0;
+static size_t history_count = 0;
+static size_t total_bytes = 0;
+static uint32_t blocks_written = 0; // estimated block programs over the partition's lifetime
+static uint32_t blocks_saved = 0;   // value last stored in NVS
+
+// Rough cost of a write: copy-on-write data blocks plus one metadata commit
+static uint32_t estimate_blocks(size_t size) {
+    return (uint32_t)((size + FILESYSTEM_BLOCK_SIZE - 1) / FILESYSTEM_BLOCK_SIZE) + 1;
+}
+
+// Caller holds stats_lock
+static path_stats_t *find_path(const char *path, bool create) {
+    char key[FS_STATS_PATH_MAX];
+    snprintf(key, sizeof(key), "%s", path);
+
+    path_stats_t *victim = &paths[0];
+    for (size_t i = 0; i < FILESYSTEM_STATS_MAX_PATHS; i++) {
+        if (paths[i].writes > 0 && strcmp(paths[i].path, key) == 0) {
+            return &paths[i];
+        }
+        if (paths[i].writes < victim->writes) {
+            victim = &paths[i];
+        }
+    }
+    if (!create) {
+        return NULL;
+    }
+
+    // Table full: the least written path makes room
+    untracked_writes += victim->writes;
+    memset(victim, 0, sizeof(*victim));
+    snprintf(victim->path, sizeof(victim->path), "%s", key);
+    return victim;
+}
+
+static void record_write(const char *path, size_t size) {
+    if (stats_lock == NULL) {
+        return;
+    }
+
+    xSemaphoreTake(stats_lock, portMAX_DELAY);
+    path_stats_t *entry = find_path(path, true);
+    entry->writes++;
+    entry->bytes += size;
+    blocks_written += estimate_blocks(size);
+    xSemaphoreGive(stats_lock);
+
+    // Restarts the idle countdown of the maintenance task
+    if (maintenance_task_handle != NULL) {
+        xTaskNotifyGive(maintenance_task_handle);
+    }
+}
+
+// A rename moves the history of the temporary file onto its final name
+static void record_rename(const char *from, const char *to) {
+    if (stats_lock == NULL) {
+        return;
+    }
+
+    xSemaphoreTake(stats_lock, portMAX_DELAY);
+    path_stats_t *source = find_path(from, false);
+    path_stats_t moved = {0};
+    if (source != NULL) {
+        moved = *source;
+        memset(source, 0, sizeof(*source));
+    }
+    path_stats_t *entry = find_path(to, true);
+    entry->writes += moved.writes > 0 ? moved.writes : 1;
+    entry->bytes += moved.bytes;
+    blocks_written += estimate_blocks(0);
+    xSemaphoreGive(stats_lock);
+
+    if (maintenance_task_handle != NULL) {
+        xTaskNotifyGive(maintenance_task_handle);
+    }
+}
+
+static void sample_usage(void) {
+    size_t total, used;
+    if (filesystem_lfs_info(&total, &used) != ESP_OK) {
+        return;
+    }
+
+    usage_sample_t sample = {
+        .uptime = (uint32_t)(esp_timer_get_time() / 1000000),
+        .used = (uint32_t)used,
+    };
+
+    xSemaphoreTake(stats_lock, portMAX_DELAY);
+    total_bytes = total;
+    history_head = (history_head + 1) % FILESYSTEM_HISTORY_SIZE;
+    history[history_head] = sample;
+    if (history_count < FILESYSTEM_HISTORY_SIZE) {
+        history_count++;
+    }
+    xSemaphoreGive(stats_lock);
+}
+
+void filesystem_maintenance_run(void) {
+    TRACE_SCOPE("filesystem_maintenance_run");
+
+    if (stats_lock == NULL) {
+        return;
+    }
+
+    // Free-block scans and metadata compaction run now instead of inside the next write
+    int64_t start = esp_timer_get_time();
+    esp_err_t ret = filesystem_lfs_gc();
+    ESP_LOGD(TAG, "GC %s in %lld us", esp_err_to_name(ret), (long long)(esp_timer_get_time() - start));
+
+    sample_usage();
+
+    xSemaphoreTake(stats_lock, portMAX_DELAY);
+    uint32_t blocks = blocks_written;
+    xSemaphoreGive(stats_lock);
+
+    if (blocks != blocks_saved && nvs_cache_put_i32(FS_WEAR_NVS_KEY, (int32_t)blocks) == ESP_OK) {
+        blocks_saved = blocks;
+    }
+}
+
+static void maintenance_task(void *arg) {
+    bool dirty = false;
+
+    while (1) {
+        // Every write restarts the countdown, so a burst of writes costs one NVS commit
+        TickType_t wait = pdMS_TO_TICKS(dirty ? FILESYSTEM_STATS_IDLE_MS : FILESYSTEM_SAMPLE_INTERVAL_MS);
+        if (ulTaskNotifyTake(pdTRUE, wait) > 0) {
+            dirty = true;
+            continue;
+        }
+
+        if (dirty) {
+            filesystem_maintenance_run();
+            dirty = false;
+            ESP_LOGD(TAG, "Maintenance stack high-water mark: %u bytes", (unsigned)uxTaskGetStackHighWaterMark(NULL));
+        } else {
+            sample_usage();
+        }
+    }
+}
+
+static esp_err_t start_maintenance(void) {
+    if (stats_lock == NULL) {
+        stats_lock = xSemaphoreCreateMutex();
+        if (stats_lock == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    int32_t saved;
+    if (nvs_cache_get_i32(FS_WEAR_NVS_KEY, &saved) == ESP_OK && saved > 0) {
+        blocks_written = blocks_saved = (uint32_t)saved;
+    }
+    sample_usage();
+
+    if (maintenance_task_handle == NULL &&
+        xTaskCreate(maintenance_task, "fs_maint", MAINTENANCE_TASK_STACK_SIZE, NULL, MAINTENANCE_TASK_PRIORITY,
+                    &maintenance_task_handle) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
 esp_err_t filesystem_init(void) {
     esp_err_t ret;
 
     ESP_LOGI(TAG, "Initializing LittleFS");
     ESP_LOGI(TAG, "First boot may take up to 15 seconds (formatting 1MB partition)...");
 
-    esp_vfs_littlefs_conf_t conf = {
-        .base_path = LITTLEFS_BASE_PATH,
-        .partition_label = LITTLEFS_PARTITION_LABEL,
-        .format_if_mount_failed = true,
-        .dont_mount = false,
-    };
-
     ESP_LOGI(TAG, "Mounting LittleFS partition '%s'...", LITTLEFS_PARTITION_LABEL);
-    ret = esp_vfs_littlefs_register(&conf);
+    ret = filesystem_lfs_mount();
 
     if (ret != ESP_OK) {
         if (ret == ESP_FAIL) {
@@ -38,15 +226,22 @@ esp_err_t filesystem_init(void) {
     }
 
     size_t total = 0, used = 0;
-    ret = esp_littlefs_info(LITTLEFS_PARTITION_LABEL, &total, &used);
+    ret = filesystem_lfs_info(&total, &used);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to get LittleFS partition information (%s)", esp_err_to_name(ret));
-        esp_vfs_littlefs_unregister(LITTLEFS_PARTITION_LABEL);
+        filesystem_lfs_unmount();
         return ret;
     } else {
         ESP_LOGI(TAG, "Partition size: total: %d, used: %d", total, used);
     }
 
+    ret = start_maintenance();
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start maintenance task (%s)", esp_err_to_name(ret));
+        filesystem_lfs_unmount();
+        return ret;
+    }
+
     ESP_LOGI(TAG, "LittleFS mounted successfully at %s", LITTLEFS_BASE_PATH);
     ESP_LOGI(TAG, "Web files should be uploaded to the storage partition separately");
 
@@ -55,7 +250,7 @@ esp_err_t filesystem_init(void) {
 
 esp_err_t filesystem_deinit(void) {
     ESP_LOGI(TAG, "Unmounting LittleFS partition '%s'...", LITTLEFS_PARTITION_LABEL);
-    esp_err_t ret = esp_vfs_littlefs_unregister(LITTLEFS_PARTITION_LABEL);
+    esp_err_t ret = filesystem_lfs_unmount();
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to unmount LittleFS (%s)", esp_err_to_name(ret));
         return ret;
@@ -64,7 +259,18 @@ esp_err_t filesystem_deinit(void) {
     return ESP_OK;
 }
 
+esp_err_t filesystem_get_info(size_t *total, size_t *used) {
+    TRACE_SCOPE("filesystem_get_info");
+
+    if (total == NULL || used == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return filesystem_lfs_info(total, used);
+}
+
 esp_err_t filesystem_read_file(const char *path, char *buffer, size_t buffer_size, size_t *bytes_read) {
+    TRACE_SCOPE("filesystem_read_file");
+
     if (path == NULL || buffer == NULL || buffer_size == 0) {
         return ESP_ERR_INVALID_ARG;
     }
@@ -94,31 +300,165 @@ esp_err_t filesystem_read_file(const char *path, char *buffer, size_t buffer_siz
     return ESP_OK;
 }
 
-esp_err_t filesystem_write_file(const char *path, const char *data, size_t data_size) {
+static esp_err_t make_parent_dirs(const char *path) {
+    char dir[256];
+    size_t len = strlen(path);
+    if (len >= sizeof(dir)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memcpy(dir, path, len + 1);
+
+    // Walk every separator after the leading one and create missing levels
+    for (char *p = dir + 1; *p != '\0'; p++) {
+        if (*p != '/') {
+            continue;
+        }
+        *p = '\0';
+        if (mkdir(dir, 0775) != 0 && errno != EEXIST) {
+            ESP_LOGE(TAG, "Failed to create directory '%s': %s", dir, strerror(errno));
+            return ESP_FAIL;
+        }
+        *p = '/';
+    }
+
+    return ESP_OK;
+}
+
+static void publish_file_event(event_id_t id, const char *path, size_t size) {
+    event_file_t event = {.size = size};
+    snprintf(event.path, sizeof(event.path), "%s", path);
+    event_bus_publish(id, &event, sizeof(event));
+}
+
+static esp_err_t write_with_mode(const char *path, const char *data, size_t data_size, const char *mode) {
     if (path == NULL || data == NULL) {
         return ESP_ERR_INVALID_ARG;
     }
 
-    FILE *file = fopen(path, "w");
+    TRACE_SPAN_BEGIN(open_span, "fopen");
+    FILE *file = fopen(path, mode);
+    if (file == NULL && errno == ENOENT && make_parent_dirs(path) == ESP_OK) {
+        file = fopen(path, mode);
+    }
+    TRACE_SPAN_END(open_span);
     if (file == NULL) {
         ESP_LOGE(TAG, "Failed to open file '%s' for writing: %s", path, strerror(errno));
         return ESP_FAIL;
     }
 
+    TRACE_SPAN_BEGIN(write_span, "fwrite");
     size_t written = fwrite(data, 1, data_size, file);
+    TRACE_SPAN_END(write_span);
     if (written != data_size) {
         ESP_LOGE(TAG, "Failed to write all data to '%s' (wrote %d of %d bytes)", path, written, data_size);
         fclose(file);
         return ESP_FAIL;
     }
 
+    // LittleFS commits on close, this is usually the expensive part
+    TRACE_SPAN_BEGIN(close_span, "fclose");
     fclose(file);
+    TRACE_SPAN_END(close_span);
+
+    ESP_LOGD(TAG, "Wrote %d bytes to '%s'", data_size, path);
+    record_write(path, data_size);
+    publish_file_event(EVENT_FILE_WRITTEN, path, data_size);
+    return ESP_OK;
+}
+
+esp_err_t filesystem_write_file(const char *path, const char *data, size_t data_size) {
+    TRACE_SCOPE("filesystem_write_file");
+    return write_with_mode(path, data, data_size, "w");
+}
+
+esp_err_t filesystem_append_file(const char *path, const char *data, size_t data_size) {
+    TRACE_SCOPE("filesystem_append_file");
+    return write_with_mode(path, data, data_size, "a");
+}
+
+esp_err_t filesystem_write_stream(const char *path, size_t data_size, char *buffer, size_t buffer_size,
+                                  filesystem_read_fn read, void *ctx) {
+    TRACE_SCOPE("filesystem_write_stream");
+
+    char tmppath[FS_TMP_PATH_MAX];
+    if (path == NULL || buffer == NULL || buffer_size == 0 || read == NULL ||
+        snprintf(tmppath, sizeof(tmppath), "%s.tmp", path) >= (int)sizeof(tmppath)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    TRACE_SPAN_BEGIN(open_span, "fopen");
+    FILE *file = fopen(tmppath, "w");
+    if (file == NULL && errno == ENOENT && make_parent_dirs(tmppath) == ESP_OK) {
+        file = fopen(tmppath, "w");
+    }
+    TRACE_SPAN_END(open_span);
+    if (file == NULL) {
+        ESP_LOGE(TAG, "Failed to open file '%s' for writing: %s", tmppath, strerror(errno));
+        return ESP_FAIL;
+    }
+
+    size_t remaining = data_size;
+    while (remaining > 0) {
+        int received = read(ctx, buffer, remaining < buffer_size ? remaining : buffer_size);
+        if (received <= 0) {
+            ESP_LOGE(TAG, "Write of '%s' aborted with %d bytes left", path, remaining);
+            break;
+        }
+        TRACE_SPAN_BEGIN(write_span, "fwrite");
+        size_t written = fwrite(buffer, 1, received, file);
+        TRACE_SPAN_END(write_span);
+        if (written != (size_t)received) {
+            ESP_LOGE(TAG, "Failed to write all data to '%s' (%d bytes left)", tmppath, remaining);
+            break;
+        }
+        remaining -= received;
+    }
+
+    // LittleFS commits on close, once per file instead of once per chunk
+    TRACE_SPAN_BEGIN(close_span, "fclose");
+    bool closed = fclose(file) == 0;
+    TRACE_SPAN_END(close_span);
+
+    if (remaining > 0 || !closed || rename(tmppath, path) != 0) {
+        if (remaining == 0) {
+            ESP_LOGE(TAG, "Failed to commit '%s': %s", path, strerror(errno));
+        }
+        unlink(tmppath);
+        return ESP_FAIL;
+    }
 
     ESP_LOGD(TAG, "Wrote %d bytes to '%s'", data_size, path);
+    record_write(path, data_size);
+    publish_file_event(EVENT_FILE_WRITTEN, path, data_size);
+    return ESP_OK;
+}
+
+esp_err_t filesystem_rename_file(const char *from, const char *to) {
+    TRACE_SCOPE("filesystem_rename_file");
+
+    if (from == NULL || to == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (rename(from, to) != 0) {
+        if (errno == ENOENT) {
+            ESP_LOGD(TAG, "File '%s' does not exist", from);
+            return ESP_ERR_NOT_FOUND;
+        }
+        ESP_LOGE(TAG, "Failed to rename '%s' to '%s': %s", from, to, strerror(errno));
+        return ESP_FAIL;
+    }
+
+    ESP_LOGD(TAG, "Renamed '%s' to '%s'", from, to);
+    record_rename(from, to);
+    struct stat st;
+    publish_file_event(EVENT_FILE_WRITTEN, to, stat(to, &st) == 0 ? (size_t)st.st_size : 0);
     return ESP_OK;
 }
 
 bool filesystem_file_exists(const char *path) {
+    TRACE_SCOPE("filesystem_file_exists");
+
     if (path == NULL) {
         return false;
     }
@@ -128,6 +468,8 @@ bool filesystem_file_exists(const char *path) {
 }
 
 esp_err_t filesystem_delete_file(const char *path) {
+    TRACE_SCOPE("filesystem_delete_file");
+
     if (path == NULL) {
         return ESP_ERR_INVALID_ARG;
     }
@@ -142,5 +484,88 @@ esp_err_t filesystem_delete_file(const char *path) {
     }
 
     ESP_LOGD(TAG, "Deleted file '%s'", path);
+    publish_file_event(EVENT_FILE_DELETED, path, 0);
     return ESP_OK;
 }
+
+static bool append(char *buffer, size_t buffer_size, size_t *len, const char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    int n = vsnprintf(buffer + *len, buffer_size - *len, fmt, args);
+    va_end(args);
+    if (n < 0 || (size_t)n >= buffer_size - *len) {
+        return false;
+    }
+    *len += n;
+    return true;
+}
+
+// Caller holds stats_lock; formatting in place avoids copying both tables onto the caller's stack
+static bool stats_to_json(char *buffer, size_t buffer_size, size_t *len) {
+    const usage_sample_t *oldest = &history[(history_head + FILESYSTEM_HISTORY_SIZE - history_count + 1) %
+                                            FILESYSTEM_HISTORY_SIZE];
+    const usage_sample_t *newest = &history[history_head];
+    uint32_t used = history_count > 0 ? newest->used : 0;
+
+    // Change in used bytes per hour across the history window
+    long trend = 0;
+    if (history_count > 1 && newest->uptime > oldest->uptime) {
+        trend = (long)(((int64_t)newest->used - (int64_t)oldest->used) * 3600 / (newest->uptime - oldest->uptime));
+    }
+
+    // Dynamic wear leveling spreads erases over the whole partition, so the average is the estimate
+    uint32_t block_count = total_bytes / FILESYSTEM_BLOCK_SIZE;
+    uint64_t avg_x100 = block_count > 0 ? (uint64_t)blocks_written * 100 / block_count : 0;
+    uint64_t wear_ppm =
+        block_count > 0 ? (uint64_t)blocks_written * 1000000 / ((uint64_t)block_count * FILESYSTEM_ERASE_CYCLES) : 0;
+
+    bool ok = append(buffer, buffer_size, len,
+                     "{\"total\":%u,\"used\":%lu,\"trend_bytes_per_hour\":%ld,"
+                     "\"wear\":{\"blocks_written\":%lu,\"avg_erases\":%lu.%02lu,\"rated_cycles\":%lu,\"ppm\":%lu},"
+                     "\"untracked_writes\":%lu,\"paths\":[",
+                     (unsigned)total_bytes, (unsigned long)used, trend, (unsigned long)blocks_written,
+                     (unsigned long)(avg_x100 / 100), (unsigned long)(avg_x100 % 100),
+                     (unsigned long)FILESYSTEM_ERASE_CYCLES, (unsigned long)wear_ppm, (unsigned long)untracked_writes);
+
+    bool first = true;
+    for (size_t i = 0; i < FILESYSTEM_STATS_MAX_PATHS && ok; i++) {
+        const path_stats_t *p = &paths[i];
+        if (p->writes == 0) {
+            continue;
+        }
+        ok = append(buffer, buffer_size, len, "%s{\"path\":\"", first ? "" : ",");
+        // Paths come from HTTP requests; keep the JSON valid without a full escaper
+        for (const char *c = p->path; *c != '\0' && ok; c++) {
+            bool plain = *c != '"' && *c != '\\' && (unsigned char)*c >= 0x20;
+            ok = append(buffer, buffer_size, len, "%c", plain ? *c : '?');
+        }
+        ok = ok && append(buffer, buffer_size, len, "\",\"writes\":%lu,\"bytes\":%lu}", (unsigned long)p->writes,
+                          (unsigned long)p->bytes);
+        first = false;
+    }
+
+    ok = ok && append(buffer, buffer_size, len, "],\"history\":[");
+
+    // Oldest first so the array plots left to right
+    for (size_t i = 0; i < history_count && ok; i++) {
+        const usage_sample_t *sample =
+            &history[(history_head + FILESYSTEM_HISTORY_SIZE - history_count + 1 + i) % FILESYSTEM_HISTORY_SIZE];
+        ok = append(buffer, buffer_size, len, "%s{\"uptime\":%lu,\"used\":%lu}", i ? "," : "",
+                    (unsigned long)sample->uptime, (unsigned long)sample->used);
+    }
+
+    return ok && append(buffer, buffer_size, len, "]}");
+}
+
+size_t filesystem_to_json(char *buffer, size_t buffer_size) {
+    if (stats_lock == NULL) {
+        return 0;
+    }
+
+    size_t len = 0;
+    xSemaphoreTake(stats_lock, portMAX_DELAY);
+    bool ok = stats_to_json(buffer, buffer_size, &len);
+    xSemaphoreGive(stats_lock);
+
+    return ok ? len : 0;
+}
@@ -0,0 +1,359 @@
+#include "filesystem_lfs.h"
+#include "esp_log.h"
+#include "esp_partition.h"
+#include "esp_vfs.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "lfs.h"
+#include "radio_wazoo_config.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <string.h>
+#include <sys/stat.h>
+
+static const char *const TAG = "FILESYSTEM_LFS";
+
+typedef struct {
+    lfs_file_t file;
+    bool open;
+} open_file_t;
+
+// LittleFS is not thread-safe; every call below holds lfs_lock
+static SemaphoreHandle_t lfs_lock = NULL;
+static const esp_partition_t *partition = NULL;
+static lfs_t lfs;
+static struct lfs_config lfs_cfg;
+static open_file_t files[FILESYSTEM_MAX_OPEN_FILES];
+static bool mounted = false;
+
+static int bd_read(const struct lfs_config *c, lfs_block_t block, lfs_off_t off, void *buffer, lfs_size_t size) {
+    return esp_partition_read(partition, block * c->block_size + off, buffer, size) == ESP_OK ? 0 : LFS_ERR_IO;
+}
+
+static int bd_prog(const struct lfs_config *c, lfs_block_t block, lfs_off_t off, const void *buffer,
+                   lfs_size_t size) {
+    return esp_partition_write(partition, block * c->block_size + off, buffer, size) == ESP_OK ? 0 : LFS_ERR_IO;
+}
+
+static int bd_erase(const struct lfs_config *c, lfs_block_t block) {
+    return esp_partition_erase_range(partition, block * c->block_size, c->block_size) == ESP_OK ? 0 : LFS_ERR_IO;
+}
+
+// esp_partition_write() has reached flash when it returns
+static int bd_sync(const struct lfs_config *c) {
+    return 0;
+}
+
+static int to_errno(int err) {
+    switch (err) {
+    case LFS_ERR_NOENT:
+        return ENOENT;
+    case LFS_ERR_EXIST:
+        return EEXIST;
+    case LFS_ERR_NOTDIR:
+        return ENOTDIR;
+    case LFS_ERR_ISDIR:
+        return EISDIR;
+    case LFS_ERR_NOTEMPTY:
+        return ENOTEMPTY;
+    case LFS_ERR_BADF:
+        return EBADF;
+    case LFS_ERR_FBIG:
+        return EFBIG;
+    case LFS_ERR_INVAL:
+        return EINVAL;
+    case LFS_ERR_NOSPC:
+        return ENOSPC;
+    case LFS_ERR_NOMEM:
+        return ENOMEM;
+    case LFS_ERR_NAMETOOLONG:
+        return ENAMETOOLONG;
+    default:
+        return EIO;
+    }
+}
+
+static int fail(int err) {
+    errno = to_errno(err);
+    return -1;
+}
+
+// Caller holds lfs_lock
+static bool is_open(int fd) {
+    return fd >= 0 && fd < FILESYSTEM_MAX_OPEN_FILES && files[fd].open;
+}
+
+static int open_flags(int flags) {
+    int lfs_flags;
+    switch (flags & O_ACCMODE) {
+    case O_RDONLY:
+        lfs_flags = LFS_O_RDONLY;
+        break;
+    case O_WRONLY:
+        lfs_flags = LFS_O_WRONLY;
+        break;
+    default:
+        lfs_flags = LFS_O_RDWR;
+        break;
+    }
+    if (flags & O_CREAT) {
+        lfs_flags |= LFS_O_CREAT;
+    }
+    if (flags & O_EXCL) {
+        lfs_flags |= LFS_O_EXCL;
+    }
+    if (flags & O_TRUNC) {
+        lfs_flags |= LFS_O_TRUNC;
+    }
+    if (flags & O_APPEND) {
+        lfs_flags |= LFS_O_APPEND;
+    }
+    return lfs_flags;
+}
+
+// Paths arrive with LITTLEFS_BASE_PATH already stripped, e.g. "/www/index.html"
+static int vfs_open(const char *path, int flags, int mode) {
+    xSemaphoreTake(lfs_lock, portMAX_DELAY);
+    int fd = 0;
+    while (fd < FILESYSTEM_MAX_OPEN_FILES && files[fd].open) {
+        fd++;
+    }
+    if (fd == FILESYSTEM_MAX_OPEN_FILES) {
+        xSemaphoreGive(lfs_lock);
+        errno = ENFILE;
+        return -1;
+    }
+    int err = lfs_file_open(&lfs, &files[fd].file, path, open_flags(flags));
+    files[fd].open = err == 0;
+    xSemaphoreGive(lfs_lock);
+
+    return err < 0 ? fail(err) : fd;
+}
+
+static ssize_t vfs_read(int fd, void *dst, size_t size) {
+    xSemaphoreTake(lfs_lock, portMAX_DELAY);
+    lfs_ssize_t n = is_open(fd) ? lfs_file_read(&lfs, &files[fd].file, dst, size) : LFS_ERR_BADF;
+    xSemaphoreGive(lfs_lock);
+
+    return n < 0 ? fail(n) : n;
+}
+
+static ssize_t vfs_write(int fd, const void *data, size_t size) {
+    xSemaphoreTake(lfs_lock, portMAX_DELAY);
+    lfs_ssize_t n = is_open(fd) ? lfs_file_write(&lfs, &files[fd].file, data, size) : LFS_ERR_BADF;
+    xSemaphoreGive(lfs_lock);
+
+    return n < 0 ? fail(n) : n;
+}
+
+static off_t vfs_lseek(int fd, off_t offset, int whence) {
+    int lfs_whence = whence == SEEK_CUR ? LFS_SEEK_CUR : whence == SEEK_END ? LFS_SEEK_END : LFS_SEEK_SET;
+
+    xSemaphoreTake(lfs_lock, portMAX_DELAY);
+    lfs_soff_t pos = is_open(fd) ? lfs_file_seek(&lfs, &files[fd].file, (lfs_soff_t)offset, lfs_whence) : LFS_ERR_BADF;
+    xSemaphoreGive(lfs_lock);
+
+    return pos < 0 ? fail(pos) : pos;
+}
+
+// LittleFS commits the file here
+static int vfs_close(int fd) {
+    xSemaphoreTake(lfs_lock, portMAX_DELAY);
+    int err = LFS_ERR_BADF;
+    if (is_open(fd)) {
+        err = lfs_file_close(&lfs, &files[fd].file);
+        files[fd].open = false; // released even if the commit failed
+    }
+    xSemaphoreGive(lfs_lock);
+
+    return err < 0 ? fail(err) : 0;
+}
+
+static int vfs_fsync(int fd) {
+    xSemaphoreTake(lfs_lock, portMAX_DELAY);
+    int err = is_open(fd) ? lfs_file_sync(&lfs, &files[fd].file) : LFS_ERR_BADF;
+    xSemaphoreGive(lfs_lock);
+
+    return err < 0 ? fail(err) : 0;
+}
+
+static int vfs_fstat(int fd, struct stat *st) {
+    xSemaphoreTake(lfs_lock, portMAX_DELAY);
+    lfs_soff_t size = is_open(fd) ? lfs_file_size(&lfs, &files[fd].file) : LFS_ERR_BADF;
+    xSemaphoreGive(lfs_lock);
+
+    if (size < 0) {
+        return fail(size);
+    }
+    memset(st, 0, sizeof(*st));
+    st->st_mode = S_IFREG | 0666;
+    st->st_size = size;
+    return 0;
+}
+
+static int vfs_stat(const char *path, struct stat *st) {
+    struct lfs_info info;
+    xSemaphoreTake(lfs_lock, portMAX_DELAY);
+    int err = lfs_stat(&lfs, path, &info);
+    xSemaphoreGive(lfs_lock);
+
+    if (err < 0) {
+        return fail(err);
+    }
+    memset(st, 0, sizeof(*st));
+    st->st_mode = info.type == LFS_TYPE_DIR ? S_IFDIR | 0777 : S_IFREG | 0666;
+    st->st_size = info.type == LFS_TYPE_REG ? info.size : 0;
+    return 0;
+}
+
+static int vfs_unlink(const char *path) {
+    xSemaphoreTake(lfs_lock, portMAX_DELAY);
+    int err = lfs_remove(&lfs, path);
+    xSemaphoreGive(lfs_lock);
+
+    return err < 0 ? fail(err) : 0;
+}
+
+// Replaces an existing destination, as POSIX rename() does
+static int vfs_rename(const char *from, const char *to) {
+    xSemaphoreTake(lfs_lock, portMAX_DELAY);
+    int err = lfs_rename(&lfs, from, to);
+    xSemaphoreGive(lfs_lock);
+
+    return err < 0 ? fail(err) : 0;
+}
+
+static int vfs_mkdir(const char *path, mode_t mode) {
+    xSemaphoreTake(lfs_lock, portMAX_DELAY);
+    int err = lfs_mkdir(&lfs, path);
+    xSemaphoreGive(lfs_lock);
+
+    return err < 0 ? fail(err) : 0;
+}
+
+esp_err_t filesystem_lfs_mount(void) {
+    if (mounted) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, LITTLEFS_PARTITION_LABEL);
+    if (partition == NULL) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (lfs_lock == NULL) {
+        lfs_lock = xSemaphoreCreateMutex();
+        if (lfs_lock == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    lfs_cfg = (struct lfs_config){
+        .read = bd_read,
+        .prog = bd_prog,
+        .erase = bd_erase,
+        .sync = bd_sync,
+        .read_size = FILESYSTEM_IO_SIZE,
+        .prog_size = FILESYSTEM_IO_SIZE,
+        .block_size = FILESYSTEM_BLOCK_SIZE,
+        .block_count = partition->size / FILESYSTEM_BLOCK_SIZE,
+        .block_cycles = FILESYSTEM_BLOCK_CYCLES,
+        .cache_size = FILESYSTEM_CACHE_SIZE,
+        .lookahead_size = FILESYSTEM_LOOKAHEAD_SIZE,
+        .compact_thresh = FILESYSTEM_COMPACT_THRESH,
+    };
+
+    int err = lfs_mount(&lfs, &lfs_cfg);
+    if (err < 0) {
+        ESP_LOGW(TAG, "Mount failed (%d), formatting", err);
+        err = lfs_format(&lfs, &lfs_cfg);
+        if (err == 0) {
+            err = lfs_mount(&lfs, &lfs_cfg);
+        }
+    }
+    if (err < 0) {
+        ESP_LOGE(TAG, "Failed to mount or format '%s' (%d)", LITTLEFS_PARTITION_LABEL, err);
+        return ESP_FAIL;
+    }
+
+    // No directory listing: nothing here opens directories
+    esp_vfs_t vfs = {
+        .flags = ESP_VFS_FLAG_DEFAULT,
+        .open = vfs_open,
+        .read = vfs_read,
+        .write = vfs_write,
+        .lseek = vfs_lseek,
+        .close = vfs_close,
+        .fsync = vfs_fsync,
+        .fstat = vfs_fstat,
+        .stat = vfs_stat,
+        .unlink = vfs_unlink,
+        .rename = vfs_rename,
+        .mkdir = vfs_mkdir,
+    };
+    esp_err_t ret = esp_vfs_register(LITTLEFS_BASE_PATH, &vfs, NULL);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to register VFS at %s (%s)", LITTLEFS_BASE_PATH, esp_err_to_name(ret));
+        lfs_unmount(&lfs);
+        return ret;
+    }
+
+    mounted = true;
+    return ESP_OK;
+}
+
+esp_err_t filesystem_lfs_unmount(void) {
+    if (!mounted) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    esp_err_t ret = esp_vfs_unregister(LITTLEFS_BASE_PATH);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    xSemaphoreTake(lfs_lock, portMAX_DELAY);
+    for (int fd = 0; fd < FILESYSTEM_MAX_OPEN_FILES; fd++) {
+        if (files[fd].open) {
+            lfs_file_close(&lfs, &files[fd].file);
+            files[fd].open = false;
+        }
+    }
+    lfs_unmount(&lfs);
+    mounted = false;
+    xSemaphoreGive(lfs_lock);
+    return ESP_OK;
+}
+
+esp_err_t filesystem_lfs_info(size_t *total, size_t *used) {
+    if (!mounted) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    xSemaphoreTake(lfs_lock, portMAX_DELAY);
+    lfs_ssize_t blocks = lfs_fs_size(&lfs);
+    xSemaphoreGive(lfs_lock);
+
+    if (blocks < 0) {
+        return ESP_FAIL;
+    }
+    *total = (size_t)lfs_cfg.block_count * lfs_cfg.block_size;
+    *used = (size_t)blocks * lfs_cfg.block_size;
+    return ESP_OK;
+}
+
+esp_err_t filesystem_lfs_gc(void) {
+    if (!mounted) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    xSemaphoreTake(lfs_lock, portMAX_DELAY);
+    int err = lfs_fs_gc(&lfs);
+    xSemaphoreGive(lfs_lock);
+
+    if (err < 0) {
+        ESP_LOGW(TAG, "lfs_fs_gc failed (%d)", err);
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
@@ -0,0 +1,31 @@
+#ifndef FILESYSTEM_LFS_H
+#define FILESYSTEM_LFS_H
+
+#include "esp_err.h"
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * LittleFS on the storage partition, registered at LITTLEFS_BASE_PATH.
+ * Mounted here rather than through esp_littlefs, whose VFS keeps the lfs_t
+ * private, so the maintenance task can call lfs_fs_gc().
+ */
+esp_err_t filesystem_lfs_mount(void);
+esp_err_t filesystem_lfs_unmount(void);
+esp_err_t filesystem_lfs_info(size_t *total, size_t *used);
+
+/**
+ * Fill the free-block lookahead and compact metadata blocks above
+ * FILESYSTEM_COMPACT_THRESH, work the next write would otherwise do.
+ * Holds the filesystem lock while it runs.
+ */
+esp_err_t filesystem_lfs_gc(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FILESYSTEM_LFS_H
@@ -0,0 +1,218 @@
+#include "esp_timer.h"
+#include "lfs.h"
+#include "radio_wazoo_config.h"
+#include "unity.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * The firmware's LittleFS settings on a 1 MB RAM block device. The same
+ * write sequence runs from a fresh image twice: with block allocation and
+ * metadata compaction left to the writes, and with lfs_fs_gc() in the idle
+ * gap after every burst, as the maintenance task does. Block device calls
+ * are counted per write as well, since an erase costs tens of milliseconds
+ * on flash and nothing here.
+ */
+#define IMAGE_BLOCKS 256
+#define BENCH_FILES  16
+#define BURST_WRITES 4
+#define BENCH_WRITES 2000
+#define DATA_MAX     3072
+
+typedef struct {
+    uint32_t latency_us[BENCH_WRITES];
+    uint32_t reads[BENCH_WRITES];
+    uint32_t erases[BENCH_WRITES];
+    uint32_t gc_runs;
+    uint32_t gc_max_us;
+} bench_result_t;
+
+static uint8_t image[IMAGE_BLOCKS * FILESYSTEM_BLOCK_SIZE];
+static uint32_t bd_reads;
+static uint32_t bd_erases;
+static uint8_t data[DATA_MAX];
+static uint8_t readback[DATA_MAX];
+static size_t file_size[BENCH_FILES];
+static uint8_t file_seed[BENCH_FILES];
+static bench_result_t results[2];
+static lfs_t lfs;
+
+static int bd_read(const struct lfs_config *c, lfs_block_t block, lfs_off_t off, void *buffer, lfs_size_t size) {
+    memcpy(buffer, image + block * c->block_size + off, size);
+    bd_reads++;
+    return 0;
+}
+
+static int bd_prog(const struct lfs_config *c, lfs_block_t block, lfs_off_t off, const void *buffer,
+                   lfs_size_t size) {
+    memcpy(image + block * c->block_size + off, buffer, size);
+    return 0;
+}
+
+static int bd_erase(const struct lfs_config *c, lfs_block_t block) {
+    memset(image + block * c->block_size, 0xFF, c->block_size);
+    bd_erases++;
+    return 0;
+}
+
+static int bd_sync(const struct lfs_config *c) {
+    return 0;
+}
+
+// As filesystem_lfs_mount(), apart from the block count
+static const struct lfs_config cfg = {
+    .read = bd_read,
+    .prog = bd_prog,
+    .erase = bd_erase,
+    .sync = bd_sync,
+    .read_size = FILESYSTEM_IO_SIZE,
+    .prog_size = FILESYSTEM_IO_SIZE,
+    .block_size = FILESYSTEM_BLOCK_SIZE,
+    .block_count = IMAGE_BLOCKS,
+    .block_cycles = FILESYSTEM_BLOCK_CYCLES,
+    .cache_size = FILESYSTEM_CACHE_SIZE,
+    .lookahead_size = FILESYSTEM_LOOKAHEAD_SIZE,
+    .compact_thresh = FILESYSTEM_COMPACT_THRESH,
+};
+
+void setUp(void) {
+    memset(image, 0xFF, sizeof(image));
+    memset(file_size, 0, sizeof(file_size));
+    TEST_ASSERT_EQUAL(0, lfs_format(&lfs, &cfg));
+    TEST_ASSERT_EQUAL(0, lfs_mount(&lfs, &cfg));
+    TEST_ASSERT_EQUAL(0, lfs_mkdir(&lfs, "/www"));
+    TEST_ASSERT_EQUAL(0, lfs_mkdir(&lfs, "/data"));
+}
+
+void tearDown(void) {
+    lfs_unmount(&lfs);
+}
+
+static void path_of(char *path, size_t size, unsigned file) {
+    snprintf(path, size, "%s/f%u.bin", file % 2 ? "/www" : "/data", file);
+}
+
+static void fill(uint8_t *buffer, uint8_t seed, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        buffer[i] = (uint8_t)(seed + i * 7);
+    }
+}
+
+// Every third write is small enough to be stored inline in its directory's metadata block
+static size_t write_size(uint32_t i) {
+    return i % 3 == 0 ? 32 + i % 200 : 512 + (i * 997) % (DATA_MAX - 512);
+}
+
+static void write_file(uint32_t i, bench_result_t *result) {
+    unsigned file = (i * 7) % BENCH_FILES;
+    char path[24];
+    path_of(path, sizeof(path), file);
+    size_t size = write_size(i);
+    fill(data, (uint8_t)i, size);
+
+    uint32_t reads = bd_reads;
+    uint32_t erases = bd_erases;
+    int64_t start = esp_timer_get_time();
+    lfs_file_t f;
+    TEST_ASSERT_EQUAL(0, lfs_file_open(&lfs, &f, path, LFS_O_WRONLY | LFS_O_CREAT | LFS_O_TRUNC));
+    TEST_ASSERT_EQUAL(size, lfs_file_write(&lfs, &f, data, size));
+    TEST_ASSERT_EQUAL(0, lfs_file_close(&lfs, &f));
+    result->latency_us[i] = (uint32_t)(esp_timer_get_time() - start);
+    result->reads[i] = bd_reads - reads;
+    result->erases[i] = bd_erases - erases;
+
+    file_size[file] = size;
+    file_seed[file] = (uint8_t)i;
+}
+
+// Remounts and reads every file back, so GC cannot have lost or reordered a commit
+static void assert_files_intact(void) {
+    TEST_ASSERT_EQUAL(0, lfs_unmount(&lfs));
+    TEST_ASSERT_EQUAL(0, lfs_mount(&lfs, &cfg));
+
+    for (unsigned file = 0; file < BENCH_FILES; file++) {
+        char path[24];
+        path_of(path, sizeof(path), file);
+        lfs_file_t f;
+        TEST_ASSERT_EQUAL(0, lfs_file_open(&lfs, &f, path, LFS_O_RDONLY));
+        TEST_ASSERT_EQUAL(file_size[file], lfs_file_size(&lfs, &f));
+        TEST_ASSERT_EQUAL(file_size[file], lfs_file_read(&lfs, &f, readback, sizeof(readback)));
+        TEST_ASSERT_EQUAL(0, lfs_file_close(&lfs, &f));
+        fill(data, file_seed[file], file_size[file]);
+        TEST_ASSERT_EQUAL_MEMORY(data, readback, file_size[file]);
+    }
+}
+
+static void run(bool idle_gc, bench_result_t *result) {
+    result->gc_runs = 0;
+    result->gc_max_us = 0;
+
+    for (uint32_t i = 0; i < BENCH_WRITES; i++) {
+        write_file(i, result);
+        if (idle_gc && i % BURST_WRITES == BURST_WRITES - 1) {
+            int64_t start = esp_timer_get_time();
+            TEST_ASSERT_EQUAL(0, lfs_fs_gc(&lfs));
+            uint32_t gc_us = (uint32_t)(esp_timer_get_time() - start);
+            result->gc_max_us = gc_us > result->gc_max_us ? gc_us : result->gc_max_us;
+            result->gc_runs++;
+        }
+    }
+
+    assert_files_intact();
+}
+
+static int compare_u32(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+// Sorts in place, so call once per array
+static void percentiles(uint32_t *values, uint32_t *p50, uint32_t *p99, uint32_t *max) {
+    qsort(values, BENCH_WRITES, sizeof(values[0]), compare_u32);
+    *p50 = values[BENCH_WRITES / 2];
+    *p99 = values[BENCH_WRITES * 99 / 100];
+    *max = values[BENCH_WRITES - 1];
+}
+
+static void report(const char *name, bench_result_t *result) {
+    uint32_t us[3], reads[3], erases[3];
+    percentiles(result->latency_us, &us[0], &us[1], &us[2]);
+    percentiles(result->reads, &reads[0], &reads[1], &reads[2]);
+    percentiles(result->erases, &erases[0], &erases[1], &erases[2]);
+
+    char line[200];
+    snprintf(line, sizeof(line),
+             "%s: write p50/p99/max %u/%u/%u us, block reads %u/%u/%u, erases %u/%u/%u; %u GC runs, max %u us", name,
+             (unsigned)us[0], (unsigned)us[1], (unsigned)us[2], (unsigned)reads[0], (unsigned)reads[1],
+             (unsigned)reads[2], (unsigned)erases[0], (unsigned)erases[1], (unsigned)erases[2],
+             (unsigned)result->gc_runs, (unsigned)result->gc_max_us);
+    TEST_MESSAGE(line);
+}
+
+static void test_writes_without_idle_gc(void) {
+    run(false, &results[0]);
+    report("on demand", &results[0]);
+}
+
+static void test_writes_with_idle_gc(void) {
+    run(true, &results[1]);
+    report("idle GC", &results[1]);
+}
+
+// Nothing to collect is not an error, and a second pass finds nothing left to do
+static void test_gc_on_fresh_image(void) {
+    TEST_ASSERT_EQUAL(0, lfs_fs_gc(&lfs));
+    uint32_t erases = bd_erases;
+    TEST_ASSERT_EQUAL(0, lfs_fs_gc(&lfs));
+    TEST_ASSERT_EQUAL(erases, bd_erases);
+}
+
+void app_main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_gc_on_fresh_image);
+    RUN_TEST(test_writes_without_idle_gc);
+    RUN_TEST(test_writes_with_idle_gc);
+    exit(UNITY_END());
+}
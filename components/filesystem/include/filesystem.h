@@ -9,6 +9,12 @@
 extern "C" {
 #endif
 
+/**
+ * Supplies data for filesystem_write_stream(): fill up to size bytes of
+ * buffer and return the count, or a value <= 0 to abort the write.
+ */
+typedef int (*filesystem_read_fn)(void *ctx, char *buffer, size_t size);
+
 /**
  * @brief Initialize LittleFS filesystem
  *
@@ -23,6 +29,15 @@ esp_err_t filesystem_init(void);
  */
 esp_err_t filesystem_deinit(void);
 
+/**
+ * @brief Get partition capacity and usage
+ *
+ * @param total Pointer to store total partition size in bytes
+ * @param used Pointer to store used size in bytes
+ * @return esp_err_t ESP_OK on success
+ */
+esp_err_t filesystem_get_info(size_t *total, size_t *used);
+
 /**
  * @brief Read entire file contents into buffer
  *
@@ -37,6 +52,8 @@ esp_err_t filesystem_read_file(const char *path, char *buffer, size_t buffer_siz
 /**
  * @brief Write buffer contents to file (overwrites existing file)
  *
+ * Missing parent directories are created.
+ *
  * @param path File path (relative to mount point or absolute)
  * @param data Data to write
  * @param data_size Size of data in bytes
@@ -44,6 +61,44 @@ esp_err_t filesystem_read_file(const char *path, char *buffer, size_t buffer_siz
  */
 esp_err_t filesystem_write_file(const char *path, const char *data, size_t data_size);
 
+/**
+ * @brief Replace a file with data pulled from a reader
+ *
+ * Writes "<path>.tmp" through a single open file, then renames it over path
+ * once data_size bytes have arrived, so a failed transfer leaves the
+ * original untouched and LittleFS commits the file only once. Missing
+ * parent directories are created.
+ *
+ * @param path File path (relative to mount point or absolute)
+ * @param data_size Number of bytes to write
+ * @param buffer Scratch buffer handed to read
+ * @param buffer_size Size of buffer
+ * @param read Called until data_size bytes have been supplied
+ * @param ctx Passed to read
+ * @return esp_err_t ESP_OK on success
+ */
+esp_err_t filesystem_write_stream(const char *path, size_t data_size, char *buffer, size_t buffer_size,
+                                  filesystem_read_fn read, void *ctx);
+
+/**
+ * @brief Append buffer contents to file (creates the file if missing)
+ *
+ * @param path File path (relative to mount point or absolute)
+ * @param data Data to append
+ * @param data_size Size of data in bytes
+ * @return esp_err_t ESP_OK on success
+ */
+esp_err_t filesystem_append_file(const char *path, const char *data, size_t data_size);
+
+/**
+ * @brief Rename a file, replacing the destination if it exists
+ *
+ * @param from Current file path
+ * @param to New file path
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NOT_FOUND if source doesn't exist
+ */
+esp_err_t filesystem_rename_file(const char *from, const char *to);
+
 /**
  * @brief Check if file exists
  *
@@ -60,6 +115,24 @@ bool filesystem_file_exists(const char *path);
  */
 esp_err_t filesystem_delete_file(const char *path);
 
+/**
+ * @brief Run LittleFS garbage collection, sample usage and save the wear counter now
+ *
+ * Normally run by the maintenance task once writes have been idle for
+ * FILESYSTEM_STATS_IDLE_MS, so the lfs_fs_gc() pass and the NVS commit
+ * happen once per burst of writes and never inside one.
+ */
+void filesystem_maintenance_run(void);
+
+/**
+ * @brief Render usage trend, wear estimate and per-path write counts as JSON
+ *
+ * @param buffer Output buffer
+ * @param buffer_size Size of buffer
+ * @return size_t JSON length, 0 if the buffer was too small
+ */
+size_t filesystem_to_json(char *buffer, size_t buffer_size);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,231 @@
+#include "../../../memory_budget.c"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "unity.h"
+
+// Mirrors of the private sizes in webserver.c and audio_output.c
+#define CHUNK_SIZE              1024
+#define JSON_BUFFER_SIZE        2048
+#define MEMORY_JSON_BUFFER_SIZE 4096
+#define WEBSERVER_ALLOC_CAPS    (MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT)
+#define AUDIO_BUFFER_BYTES      (AUDIO_OUTPUT_BLOCK_FRAMES * 2 * sizeof(int16_t))
+#define AUDIO_ALLOC_CAPS        (MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT)
+
+#define SOAK_ROUNDS        5000
+#define SOAK_SAMPLE_EVERY  100 // rounds per simulated telemetry tick
+#define AUDIO_CYCLES       500
+
+typedef enum {
+    REQ_STATIC,      // serve_static_file: one chunk for the whole file
+    REQ_UPLOAD,      // PUT /api/fs: one chunk streamed into filesystem_write_stream
+    REQ_JSON,        // nowplaying, network, filesystem reports
+    REQ_MEMORY,      // GET /api/memory renders the report being tested
+    REQ_SHED_CHECK,  // handlers that only consult memory_budget_under_pressure()
+} request_t;
+
+typedef struct {
+    const char *name;
+    const request_t *requests;
+    size_t count;
+} request_mix_t;
+
+#define MIX(name, ...)                                                                                                 \
+    {name, (const request_t[]){__VA_ARGS__}, sizeof((const request_t[]){__VA_ARGS__}) / sizeof(request_t)}
+
+static const request_mix_t mixes[] = {
+    MIX("page_load", REQ_SHED_CHECK, REQ_STATIC, REQ_STATIC, REQ_STATIC, REQ_JSON, REQ_JSON),
+    MIX("now_playing_poll", REQ_JSON, REQ_JSON, REQ_JSON, REQ_JSON),
+    MIX("dashboard", REQ_MEMORY, REQ_JSON, REQ_JSON, REQ_MEMORY),
+    MIX("sync", REQ_STATIC, REQ_UPLOAD, REQ_UPLOAD, REQ_UPLOAD, REQ_JSON),
+};
+
+static char report[MEMORY_JSON_BUFFER_SIZE];
+static uint32_t rng = 12345;
+
+static uint32_t next_random(void) {
+    rng = rng * 1103515245u + 12345u;
+    return rng >> 16;
+}
+
+void setUp(void) {
+    memset(usage, 0, sizeof(usage));
+    memset(history, 0, sizeof(history));
+    history_head = 0;
+    history_count = 0;
+    shed_count = 0;
+}
+
+void tearDown(void) {}
+
+// One request as the httpd task runs it: allocate, use, free
+static void replay_request(request_t request) {
+    size_t size = 0;
+    switch (request) {
+    case REQ_STATIC:
+    case REQ_UPLOAD:
+        size = CHUNK_SIZE;
+        break;
+    case REQ_JSON:
+        size = JSON_BUFFER_SIZE;
+        break;
+    case REQ_MEMORY:
+        size = MEMORY_JSON_BUFFER_SIZE;
+        break;
+    case REQ_SHED_CHECK:
+        memory_budget_under_pressure();
+        return;
+    }
+
+    char *buffer = memory_budget_alloc(MEMORY_TAG_WEBSERVER, size, WEBSERVER_ALLOC_CAPS);
+    TEST_ASSERT_NOT_NULL(buffer);
+    if (request == REQ_MEMORY) {
+        TEST_ASSERT_GREATER_THAN(0, memory_budget_to_json(buffer, size));
+    } else {
+        memset(buffer, 0xA5, size);
+    }
+    memory_budget_free(buffer);
+}
+
+static SemaphoreHandle_t audio_done;
+static volatile int audio_failures; // Unity asserts only work in the test task
+
+// audio_output_init/deinit cycles running alongside the httpd task
+static void audio_task(void *arg) {
+    for (int i = 0; i < AUDIO_CYCLES; i++) {
+        void *halves[2];
+        for (int h = 0; h < 2; h++) {
+            halves[h] = memory_budget_alloc(MEMORY_TAG_AUDIO, AUDIO_BUFFER_BYTES, AUDIO_ALLOC_CAPS);
+        }
+        taskYIELD();
+        for (int h = 0; h < 2; h++) {
+            if (halves[h] == NULL) {
+                audio_failures++;
+            }
+            memory_budget_free(halves[h]);
+        }
+    }
+    xSemaphoreGive(audio_done);
+    vTaskDelete(NULL);
+}
+
+static void assert_within_budget(memory_tag_t tag) {
+    for (int r = 0; r < REGION_MAX; r++) {
+        const memory_usage_t *u = &usage[tag][r];
+        TEST_ASSERT_EQUAL_MESSAGE(0, u->used, "allocation not credited back");
+        TEST_ASSERT_EQUAL_MESSAGE(0, u->denied, "budget too small for the request mix");
+        TEST_ASSERT_EQUAL_MESSAGE(0, u->failed, "heap refused a budgeted allocation");
+        TEST_ASSERT_LESS_OR_EQUAL(budgets[tag].budget[r], u->peak);
+    }
+}
+
+static void test_request_mixes_fit_budgets(void) {
+    size_t replayed[sizeof(mixes) / sizeof(mixes[0])] = {0};
+
+    audio_done = xSemaphoreCreateBinary();
+    TEST_ASSERT_NOT_NULL(audio_done);
+    audio_failures = 0;
+    // Same priority as the test task, so the tick time-slices the two like httpd and the audio task
+    xTaskCreate(audio_task, "audio", 4096, NULL, uxTaskPriorityGet(NULL), NULL);
+
+    for (int round = 0; round < SOAK_ROUNDS; round++) {
+        size_t m = next_random() % (sizeof(mixes) / sizeof(mixes[0]));
+        for (size_t i = 0; i < mixes[m].count; i++) {
+            replay_request(mixes[m].requests[i]);
+        }
+        replayed[m]++;
+        if (round % SOAK_SAMPLE_EVERY == 0) {
+            sample_heap(NULL);
+        }
+    }
+
+    TEST_ASSERT_TRUE(xSemaphoreTake(audio_done, pdMS_TO_TICKS(10000)));
+    vSemaphoreDelete(audio_done);
+    TEST_ASSERT_EQUAL(0, audio_failures);
+
+    for (size_t m = 0; m < sizeof(mixes) / sizeof(mixes[0]); m++) {
+        char line[64];
+        snprintf(line, sizeof(line), "%s: %u rounds", mixes[m].name, (unsigned)replayed[m]);
+        TEST_MESSAGE(line);
+        TEST_ASSERT_GREATER_THAN(0, replayed[m]);
+    }
+
+    assert_within_budget(MEMORY_TAG_WEBSERVER);
+    assert_within_budget(MEMORY_TAG_AUDIO);
+    TEST_ASSERT_EQUAL(MEMORY_JSON_BUFFER_SIZE, usage[MEMORY_TAG_WEBSERVER][REGION_INTERNAL].peak);
+    TEST_ASSERT_EQUAL(2 * AUDIO_BUFFER_BYTES, usage[MEMORY_TAG_AUDIO][REGION_INTERNAL].peak);
+    TEST_ASSERT_EQUAL(0, usage[MEMORY_TAG_AUDIO][REGION_DMA].allocs);
+}
+
+// More buffers than the budget holds: the excess is denied by the budget, never by the heap
+static void test_burst_is_denied_by_budget(void) {
+    enum { HELD_MAX = MEMORY_BUDGET_WEBSERVER_INTERNAL / JSON_BUFFER_SIZE + 2 };
+    void *held[HELD_MAX];
+    size_t granted = 0;
+
+    for (size_t i = 0; i < HELD_MAX; i++) {
+        held[i] = memory_budget_alloc(MEMORY_TAG_WEBSERVER, JSON_BUFFER_SIZE, WEBSERVER_ALLOC_CAPS);
+        if (held[i] != NULL) {
+            granted++;
+        }
+    }
+
+    const memory_usage_t *u = &usage[MEMORY_TAG_WEBSERVER][REGION_INTERNAL];
+    TEST_ASSERT_EQUAL(MEMORY_BUDGET_WEBSERVER_INTERNAL / JSON_BUFFER_SIZE, granted);
+    TEST_ASSERT_EQUAL(HELD_MAX - granted, u->denied);
+    TEST_ASSERT_EQUAL(0, u->failed);
+    TEST_ASSERT_LESS_OR_EQUAL(MEMORY_BUDGET_WEBSERVER_INTERNAL, u->used);
+
+    for (size_t i = 0; i < HELD_MAX; i++) {
+        memory_budget_free(held[i]);
+    }
+    TEST_ASSERT_EQUAL(0, u->used);
+
+    // The budget is usable again once the burst is over
+    replay_request(REQ_MEMORY);
+}
+
+// GET /api/memory must still fit its buffer with a full history and every counter at its widest
+static void test_report_fits_buffer_at_worst_case(void) {
+    for (int t = 0; t < MEMORY_TAG_MAX; t++) {
+        for (int r = 0; r < REGION_MAX; r++) {
+            usage[t][r] = (memory_usage_t){
+                .used = UINT32_MAX, .peak = UINT32_MAX, .allocs = UINT32_MAX, .denied = UINT32_MAX,
+                .failed = UINT32_MAX};
+        }
+    }
+    shed_count = UINT32_MAX;
+    for (int i = 0; i < MEMORY_HISTORY_SIZE; i++) {
+        history[i] = (memory_sample_t){
+            .uptime = UINT32_MAX, .free = UINT32_MAX, .largest = UINT32_MAX, .fragmentation = 100};
+    }
+    history_count = MEMORY_HISTORY_SIZE;
+
+    size_t len = memory_budget_to_json(report, sizeof(report));
+    TEST_ASSERT_GREATER_THAN(0, len);
+    TEST_ASSERT_NOT_NULL(strstr(report, "\"used\":4294967295,\"peak\":4294967295"));
+
+    // The region figures come from the heap, not from counters we can set; add the digits they could still grow by
+    char digits[16];
+    for (int r = 0; r < REGION_MAX; r++) {
+        multi_heap_info_t info;
+        heap_caps_get_info(&info, region_caps[r]);
+        size_t fields[] = {info.total_free_bytes, info.minimum_free_bytes, info.largest_free_block};
+        for (size_t f = 0; f < sizeof(fields) / sizeof(fields[0]); f++) {
+            len += strlen("4294967295") - snprintf(digits, sizeof(digits), "%u", (unsigned)fields[f]);
+        }
+    }
+    TEST_ASSERT_LESS_THAN(sizeof(report), len);
+
+    char line[64];
+    snprintf(line, sizeof(line), "worst-case report: %u of %u bytes", (unsigned)len, (unsigned)sizeof(report));
+    TEST_MESSAGE(line);
+    memset(usage, 0, sizeof(usage));
+}
+
+void app_main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_request_mixes_fit_budgets);
+    RUN_TEST(test_burst_is_denied_by_budget);
+    RUN_TEST(test_report_fits_buffer_at_worst_case);
+    exit(UNITY_END());
+}
@@ -0,0 +1,70 @@
+#ifndef MEMORY_BUDGET_H
+#define MEMORY_BUDGET_H
+
+#include "esp_err.h"
+#include "esp_heap_caps.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Allocation owners, each with its own budget per memory region
+ */
+typedef enum {
+    MEMORY_TAG_WEBSERVER = 0,
+    MEMORY_TAG_AUDIO,
+    MEMORY_TAG_OTHER,
+    MEMORY_TAG_MAX,
+} memory_tag_t;
+
+/**
+ * @brief Initialize budgets and start heap telemetry sampling
+ *
+ * @return esp_err_t ESP_OK on success
+ */
+esp_err_t memory_budget_init(void);
+
+/**
+ * @brief Allocate memory charged to a component budget
+ *
+ * The region is derived from caps: MALLOC_CAP_DMA, MALLOC_CAP_SPIRAM or internal.
+ *
+ * @param tag Owning component
+ * @param size Size in bytes
+ * @param caps heap_caps capabilities (e.g. MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT)
+ * @return void* Pointer or NULL when the heap or the budget is exhausted
+ */
+void *memory_budget_alloc(memory_tag_t tag, size_t size, uint32_t caps);
+
+/**
+ * @brief Free memory returned by memory_budget_alloc()
+ *
+ * @param ptr Pointer (NULL is ignored)
+ */
+void memory_budget_free(void *ptr);
+
+/**
+ * @brief Check whether internal RAM is too fragmented or too low to take on new work
+ *
+ * @return true if callers should shed load
+ */
+bool memory_budget_under_pressure(void);
+
+/**
+ * @brief Render budgets, usage and fragmentation history as JSON
+ *
+ * @param buffer Output buffer
+ * @param buffer_size Size of buffer
+ * @return size_t JSON length, 0 if the buffer was too small
+ */
+size_t memory_budget_to_json(char *buffer, size_t buffer_size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MEMORY_BUDGET_H
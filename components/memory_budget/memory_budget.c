@@ -0,0 +1,296 @@
+#include "memory_budget.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "radio_wazoo_config.h"
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *const TAG = "MEMORY_BUDGET";
+
+typedef enum {
+    REGION_INTERNAL = 0,
+    REGION_SPIRAM,
+    REGION_DMA,
+    REGION_MAX,
+} memory_region_t;
+
+static const char *const region_names[REGION_MAX] = {"internal", "spiram", "dma"};
+static const uint32_t region_caps[REGION_MAX] = {MALLOC_CAP_INTERNAL, MALLOC_CAP_SPIRAM, MALLOC_CAP_DMA};
+
+typedef struct {
+    const char *name;
+    size_t budget[REGION_MAX];
+} memory_budget_t;
+
+// clang-format off
+static const memory_budget_t budgets[MEMORY_TAG_MAX] = {
+    [MEMORY_TAG_WEBSERVER] = {"webserver", {MEMORY_BUDGET_WEBSERVER_INTERNAL, MEMORY_BUDGET_WEBSERVER_SPIRAM, 0}},
+    [MEMORY_TAG_AUDIO]     = {"audio",     {MEMORY_BUDGET_AUDIO_INTERNAL, 0, 0}},
+    [MEMORY_TAG_OTHER]     = {"other",     {SIZE_MAX, SIZE_MAX, SIZE_MAX}},
+};
+// clang-format on
+
+typedef struct {
+    size_t used;
+    size_t peak;
+    uint32_t allocs;
+    uint32_t denied; // refused by budget
+    uint32_t failed; // refused by the heap
+} memory_usage_t;
+
+// Prepended to every allocation so free() can credit the right budget
+typedef struct {
+    uint32_t size;
+    uint8_t tag;
+    uint8_t region;
+    uint16_t magic;
+} memory_header_t;
+
+#define MEMORY_HEADER_MAGIC 0xB0D6
+
+typedef struct {
+    uint32_t uptime;  // seconds
+    uint32_t free;    // internal free bytes
+    uint32_t largest; // largest internal free block
+    uint8_t fragmentation;
+} memory_sample_t;
+
+static portMUX_TYPE usage_lock = portMUX_INITIALIZER_UNLOCKED;
+static memory_usage_t usage[MEMORY_TAG_MAX][REGION_MAX];
+static uint32_t shed_count = 0;
+
+static memory_sample_t history[MEMORY_HISTORY_SIZE];
+static size_t history_head = 0;
+static size_t history_count = 0;
+static esp_timer_handle_t sample_timer = NULL;
+
+static memory_region_t region_for_caps(uint32_t caps) {
+    if (caps & MALLOC_CAP_DMA) {
+        return REGION_DMA;
+    }
+    if (caps & MALLOC_CAP_SPIRAM) {
+        return REGION_SPIRAM;
+    }
+    return REGION_INTERNAL;
+}
+
+static uint8_t fragmentation_percent(size_t free, size_t largest) {
+    if (free == 0) {
+        return 0;
+    }
+    return (uint8_t)(100 - (largest * 100) / free);
+}
+
+static void sample_heap(void *arg) {
+    size_t free = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+    size_t largest = heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL);
+
+    memory_sample_t sample = {
+        .uptime = (uint32_t)(esp_timer_get_time() / 1000000),
+        .free = free,
+        .largest = largest,
+        .fragmentation = fragmentation_percent(free, largest),
+    };
+
+    taskENTER_CRITICAL(&usage_lock);
+    history_head = (history_head + 1) % MEMORY_HISTORY_SIZE;
+    history[history_head] = sample;
+    if (history_count < MEMORY_HISTORY_SIZE) {
+        history_count++;
+    }
+    taskEXIT_CRITICAL(&usage_lock);
+
+    ESP_LOGD(TAG, "Internal free: %lu, largest block: %lu, fragmentation: %u%%", (unsigned long)sample.free,
+             (unsigned long)sample.largest, sample.fragmentation);
+}
+
+esp_err_t memory_budget_init(void) {
+    if (sample_timer != NULL) {
+        return ESP_OK;
+    }
+
+    const esp_timer_create_args_t timer_args = {
+        .callback = sample_heap,
+        .arg = NULL,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "mem_sample",
+        .skip_unhandled_events = true,
+    };
+
+    esp_err_t ret = esp_timer_create(&timer_args, &sample_timer);
+    if (ret == ESP_OK) {
+        ret = esp_timer_start_periodic(sample_timer, MEMORY_SAMPLE_INTERVAL_MS * 1000ULL);
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start heap sampling: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    sample_heap(NULL);
+    ESP_LOGI(TAG, "Memory budgets initialized, sampling every %d ms", MEMORY_SAMPLE_INTERVAL_MS);
+    return ESP_OK;
+}
+
+void *memory_budget_alloc(memory_tag_t tag, size_t size, uint32_t caps) {
+    if (tag >= MEMORY_TAG_MAX || size == 0 || size > UINT32_MAX - sizeof(memory_header_t)) {
+        return NULL;
+    }
+
+    memory_region_t region = region_for_caps(caps);
+    memory_usage_t *u = &usage[tag][region];
+
+    // Reserve against the budget first so concurrent callers cannot overshoot it together
+    taskENTER_CRITICAL(&usage_lock);
+    bool allowed = size <= budgets[tag].budget[region] - u->used;
+    if (allowed) {
+        u->used += size;
+    } else {
+        u->denied++;
+    }
+    taskEXIT_CRITICAL(&usage_lock);
+
+    if (!allowed) {
+        ESP_LOGW(TAG, "Budget exceeded: %s/%s wants %u bytes (%u in use)", budgets[tag].name, region_names[region],
+                 (unsigned)size, (unsigned)u->used);
+        return NULL;
+    }
+
+    memory_header_t *header = heap_caps_malloc(sizeof(memory_header_t) + size, caps);
+
+    taskENTER_CRITICAL(&usage_lock);
+    if (header == NULL) {
+        u->used -= size;
+        u->failed++;
+    } else {
+        u->allocs++;
+        if (u->used > u->peak) {
+            u->peak = u->used;
+        }
+    }
+    taskEXIT_CRITICAL(&usage_lock);
+
+    if (header == NULL) {
+        ESP_LOGW(TAG, "Heap exhausted: %s/%s wants %u bytes", budgets[tag].name, region_names[region],
+                 (unsigned)size);
+        return NULL;
+    }
+
+    header->size = size;
+    header->tag = tag;
+    header->region = region;
+    header->magic = MEMORY_HEADER_MAGIC;
+    return header + 1;
+}
+
+void memory_budget_free(void *ptr) {
+    if (ptr == NULL) {
+        return;
+    }
+
+    memory_header_t *header = (memory_header_t *)ptr - 1;
+    if (header->magic != MEMORY_HEADER_MAGIC || header->tag >= MEMORY_TAG_MAX || header->region >= REGION_MAX) {
+        ESP_LOGE(TAG, "Free of untracked pointer %p", ptr);
+        abort();
+    }
+
+    taskENTER_CRITICAL(&usage_lock);
+    usage[header->tag][header->region].used -= header->size;
+    taskEXIT_CRITICAL(&usage_lock);
+
+    header->magic = 0;
+    heap_caps_free(header);
+}
+
+bool memory_budget_under_pressure(void) {
+    size_t free = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+    size_t largest = heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL);
+
+    if (free >= MEMORY_SHED_MIN_FREE && largest >= MEMORY_SHED_MIN_LARGEST_BLOCK) {
+        return false;
+    }
+
+    taskENTER_CRITICAL(&usage_lock);
+    shed_count++;
+    taskEXIT_CRITICAL(&usage_lock);
+
+    ESP_LOGW(TAG, "Memory pressure: free %u, largest block %u", (unsigned)free, (unsigned)largest);
+    return true;
+}
+
+static bool __attribute__((format(printf, 4, 5)))
+append(char *buffer, size_t buffer_size, size_t *len, const char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    int n = vsnprintf(buffer + *len, buffer_size - *len, fmt, args);
+    va_end(args);
+    if (n < 0 || (size_t)n >= buffer_size - *len) {
+        return false;
+    }
+    *len += n;
+    return true;
+}
+
+size_t memory_budget_to_json(char *buffer, size_t buffer_size) {
+    memory_usage_t usage_copy[MEMORY_TAG_MAX][REGION_MAX];
+    memory_sample_t history_copy[MEMORY_HISTORY_SIZE];
+    size_t count, head;
+    uint32_t shed;
+
+    taskENTER_CRITICAL(&usage_lock);
+    memcpy(usage_copy, usage, sizeof(usage_copy));
+    memcpy(history_copy, history, sizeof(history_copy));
+    count = history_count;
+    head = history_head;
+    shed = shed_count;
+    taskEXIT_CRITICAL(&usage_lock);
+
+    size_t len = 0;
+    bool ok = append(buffer, buffer_size, &len, "{\"regions\":{");
+
+    for (int r = 0; r < REGION_MAX && ok; r++) {
+        multi_heap_info_t info;
+        heap_caps_get_info(&info, region_caps[r]);
+        ok = append(buffer, buffer_size, &len,
+                    "%s\"%s\":{\"free\":%u,\"min_free\":%u,\"largest\":%u,\"fragmentation\":%u}", r ? "," : "",
+                    region_names[r], (unsigned)info.total_free_bytes, (unsigned)info.minimum_free_bytes,
+                    (unsigned)info.largest_free_block,
+                    fragmentation_percent(info.total_free_bytes, info.largest_free_block));
+    }
+
+    ok = ok && append(buffer, buffer_size, &len, "},\"shed\":%lu,\"components\":{", (unsigned long)shed);
+
+    for (int t = 0; t < MEMORY_TAG_MAX && ok; t++) {
+        ok = append(buffer, buffer_size, &len, "%s\"%s\":{", t ? "," : "", budgets[t].name);
+        for (int r = 0; r < REGION_MAX && ok; r++) {
+            const memory_usage_t *u = &usage_copy[t][r];
+            if (budgets[t].budget[r] == SIZE_MAX) {
+                ok = append(buffer, buffer_size, &len, "%s\"%s\":{\"budget\":null", r ? "," : "", region_names[r]);
+            } else {
+                ok = append(buffer, buffer_size, &len, "%s\"%s\":{\"budget\":%u", r ? "," : "", region_names[r],
+                            (unsigned)budgets[t].budget[r]);
+            }
+            ok = ok && append(buffer, buffer_size, &len,
+                              ",\"used\":%u,\"peak\":%u,\"allocs\":%lu,\"denied\":%lu,\"failed\":%lu}",
+                              (unsigned)u->used, (unsigned)u->peak, (unsigned long)u->allocs, (unsigned long)u->denied, (unsigned long)u->failed);
+        }
+        ok = ok && append(buffer, buffer_size, &len, "}");
+    }
+
+    ok = ok && append(buffer, buffer_size, &len, "},\"history\":[");
+
+    // Oldest first so the array plots left to right
+    for (size_t i = 0; i < count && ok; i++) {
+        const memory_sample_t *s = &history_copy[(head + MEMORY_HISTORY_SIZE - count + 1 + i) % MEMORY_HISTORY_SIZE];
+        ok = append(buffer, buffer_size, &len, "%s{\"uptime\":%lu,\"free\":%lu,\"largest\":%lu,\"fragmentation\":%u}",
+                    i ? "," : "", (unsigned long)s->uptime, (unsigned long)s->free, (unsigned long)s->largest,
+                    s->fragmentation);
+    }
+
+    ok = ok && append(buffer, buffer_size, &len, "]}");
+
+    return ok ? len : 0;
+}
@@ -0,0 +1,222 @@
+#include "icy_demux.h"
+#include "unity.h"
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * The capture is built in the Icecast wire format: METAINT audio bytes,
+ * a length byte counting 16-byte units, then the NUL-padded metadata.
+ * Audio bytes follow a position-dependent pattern so a dropped, repeated
+ * or misplaced byte shows up in the comparison.
+ */
+#define METAINT     256
+#define MAX_BLOCKS  12
+#define CAPTURE_MAX (MAX_BLOCKS * (METAINT + 1 + ICY_META_MAX) + METAINT)
+
+// NULL means a zero length byte: no metadata change, the common case
+static const char *const capture_meta[] = {
+    "StreamTitle='Daft Punk - Around the World';StreamUrl='';",
+    NULL,
+    NULL,
+    "StreamTitle='Guns N' Roses - Sweet Child O' Mine';StreamUrl='http://radio.example/gnr';",
+    "StreamTitle='Rock';n';Roll';",         // the "';" terminator inside a title
+    "StreamTitle='0123456789abcdefg';",     // exactly 32 bytes, no padding
+    NULL,                                   // replaced by a block of the largest size, see build_capture()
+    "StreamTitle='';",
+    "StreamTitle='Caf\xc3\xa9 del Mar - Last';",
+};
+#define CAPTURE_BLOCKS (sizeof(capture_meta) / sizeof(capture_meta[0]))
+#define LONGEST_BLOCK  6
+
+static uint8_t capture[CAPTURE_MAX];
+static size_t capture_len;
+static uint8_t expected_audio[CAPTURE_MAX];
+static size_t expected_audio_len;
+static char longest[ICY_META_MAX + 1];
+
+static uint8_t audio_out[CAPTURE_MAX];
+static size_t audio_out_len;
+static char meta_out[MAX_BLOCKS][ICY_META_MAX + 1];
+static size_t meta_count;
+
+static icy_demux_t demux;
+
+static void on_audio(void *ctx, const uint8_t *data, size_t len) {
+    TEST_ASSERT_LESS_OR_EQUAL(sizeof(audio_out) - audio_out_len, len);
+    memcpy(audio_out + audio_out_len, data, len);
+    audio_out_len += len;
+}
+
+static void on_meta(void *ctx, const char *meta, size_t len) {
+    TEST_ASSERT_LESS_OR_EQUAL(MAX_BLOCKS - 1, meta_count);
+    TEST_ASSERT_EQUAL(strlen(meta), len);
+    memcpy(meta_out[meta_count++], meta, len + 1);
+}
+
+static const char *block_meta(size_t i) {
+    return i == LONGEST_BLOCK ? longest : capture_meta[i];
+}
+
+static void append_audio(size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        uint8_t byte = (uint8_t)(expected_audio_len * 31 + 7);
+        capture[capture_len++] = byte;
+        expected_audio[expected_audio_len++] = byte;
+    }
+}
+
+static void build_capture(void) {
+    // 255 units of 16 bytes with no padding, a title that fills the largest legal block
+    memset(longest, 'x', ICY_META_MAX);
+    memcpy(longest, "StreamTitle='", 13);
+    memcpy(longest + ICY_META_MAX - 2, "';", 2);
+    longest[ICY_META_MAX] = '\0';
+
+    capture_len = 0;
+    expected_audio_len = 0;
+    for (size_t i = 0; i < CAPTURE_BLOCKS; i++) {
+        append_audio(METAINT);
+        const char *meta = block_meta(i);
+        size_t len = meta != NULL ? strlen(meta) : 0;
+        size_t units = (len + 15) / 16;
+        capture[capture_len++] = (uint8_t)units;
+        memset(capture + capture_len, 0, units * 16);
+        if (meta != NULL) {
+            memcpy(capture + capture_len, meta, len);
+        }
+        capture_len += units * 16;
+    }
+    append_audio(METAINT / 2); // the capture ends mid-interval
+}
+
+void setUp(void) {
+    audio_out_len = 0;
+    meta_count = 0;
+    icy_demux_init(&demux, METAINT, on_audio, on_meta, NULL);
+}
+
+void tearDown(void) {}
+
+static void assert_demuxed(void) {
+    TEST_ASSERT_EQUAL(expected_audio_len, audio_out_len);
+    TEST_ASSERT_EQUAL_MEMORY(expected_audio, audio_out, expected_audio_len);
+
+    size_t m = 0;
+    for (size_t i = 0; i < CAPTURE_BLOCKS; i++) {
+        const char *meta = block_meta(i);
+        if (meta != NULL) {
+            TEST_ASSERT_LESS_OR_EQUAL(meta_count - 1, m);
+            TEST_ASSERT_EQUAL_STRING(meta, meta_out[m++]);
+        }
+    }
+    TEST_ASSERT_EQUAL(m, meta_count);
+}
+
+static void test_whole_capture(void) {
+    icy_demux_feed(&demux, capture, capture_len);
+    assert_demuxed();
+}
+
+// Every two-way split, which includes splitting right before, after and inside each metadata block
+static void test_every_split_point(void) {
+    for (size_t split = 1; split < capture_len; split++) {
+        setUp();
+        icy_demux_feed(&demux, capture, split);
+        icy_demux_feed(&demux, capture + split, capture_len - split);
+        assert_demuxed();
+    }
+}
+
+// The length byte arriving alone, with the metadata and audio in later reads
+static void test_length_byte_alone(void) {
+    size_t length_byte = METAINT; // first block's length byte
+    icy_demux_feed(&demux, capture, length_byte);
+    icy_demux_feed(&demux, capture + length_byte, 1);
+    TEST_ASSERT_EQUAL(0, meta_count);
+    icy_demux_feed(&demux, capture + length_byte + 1, capture_len - length_byte - 1);
+    assert_demuxed();
+}
+
+// Metadata spread over many reads, one byte each
+static void test_byte_at_a_time(void) {
+    for (size_t i = 0; i < capture_len; i++) {
+        icy_demux_feed(&demux, capture + i, 1);
+    }
+    assert_demuxed();
+}
+
+// Socket-like reads of random sizes
+static void test_random_reads(void) {
+    srand(1);
+    for (int round = 0; round < 200; round++) {
+        setUp();
+        size_t pos = 0;
+        while (pos < capture_len) {
+            size_t n = 1 + (size_t)rand() % 600;
+            if (n > capture_len - pos) {
+                n = capture_len - pos;
+            }
+            icy_demux_feed(&demux, capture + pos, n);
+            pos += n;
+        }
+        assert_demuxed();
+    }
+}
+
+// Without icy-metaint the whole stream is audio, even bytes that look like length bytes
+static void test_metaint_zero_passes_through(void) {
+    icy_demux_init(&demux, 0, on_audio, on_meta, NULL);
+    icy_demux_feed(&demux, capture, 100);
+    icy_demux_feed(&demux, capture + 100, capture_len - 100);
+
+    TEST_ASSERT_EQUAL(capture_len, audio_out_len);
+    TEST_ASSERT_EQUAL_MEMORY(capture, audio_out, capture_len);
+    TEST_ASSERT_EQUAL(0, meta_count);
+}
+
+static void test_parse_quotes_inside_title(void) {
+    char title[64];
+
+    TEST_ASSERT_TRUE(icy_parse_field(capture_meta[3], "StreamTitle", title, sizeof(title)));
+    TEST_ASSERT_EQUAL_STRING("Guns N' Roses - Sweet Child O' Mine", title);
+    TEST_ASSERT_TRUE(icy_parse_field(capture_meta[3], "StreamUrl", title, sizeof(title)));
+    TEST_ASSERT_EQUAL_STRING("http://radio.example/gnr", title);
+
+    TEST_ASSERT_TRUE(icy_parse_field(capture_meta[4], "StreamTitle", title, sizeof(title)));
+    TEST_ASSERT_EQUAL_STRING("Rock';n';Roll", title);
+
+    // Missing terminator: the last quote ends the value
+    TEST_ASSERT_TRUE(icy_parse_field("StreamTitle='It's Over'", "StreamTitle", title, sizeof(title)));
+    TEST_ASSERT_EQUAL_STRING("It's Over", title);
+}
+
+static void test_parse_edge_cases(void) {
+    char title[8];
+
+    TEST_ASSERT_TRUE(icy_parse_field(capture_meta[7], "StreamTitle", title, sizeof(title)));
+    TEST_ASSERT_EQUAL_STRING("", title);
+
+    // Cut to the buffer, always terminated
+    TEST_ASSERT_TRUE(icy_parse_field(capture_meta[0], "StreamTitle", title, sizeof(title)));
+    TEST_ASSERT_EQUAL_STRING("Daft Pu", title);
+
+    // The key must start a field, not end a longer name
+    TEST_ASSERT_FALSE(icy_parse_field("MyStreamTitle='a';", "StreamTitle", title, sizeof(title)));
+    TEST_ASSERT_FALSE(icy_parse_field(capture_meta[5], "StreamUrl", title, sizeof(title)));
+    TEST_ASSERT_FALSE(icy_parse_field("StreamTitle=", "StreamTitle", title, sizeof(title)));
+}
+
+void app_main(void) {
+    build_capture();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_whole_capture);
+    RUN_TEST(test_every_split_point);
+    RUN_TEST(test_length_byte_alone);
+    RUN_TEST(test_byte_at_a_time);
+    RUN_TEST(test_random_reads);
+    RUN_TEST(test_metaint_zero_passes_through);
+    RUN_TEST(test_parse_quotes_inside_title);
+    RUN_TEST(test_parse_edge_cases);
+    exit(UNITY_END());
+}
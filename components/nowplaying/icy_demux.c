@@ -0,0 +1,115 @@
+#include "icy_demux.h"
+#include <ctype.h>
+#include <string.h>
+
+void icy_demux_init(icy_demux_t *demux, size_t metaint, icy_audio_cb_t on_audio, icy_meta_cb_t on_meta, void *ctx) {
+    demux->metaint = metaint;
+    demux->audio_left = metaint;
+    demux->meta_left = 0;
+    demux->meta_len = 0;
+    demux->on_audio = on_audio;
+    demux->on_meta = on_meta;
+    demux->ctx = ctx;
+    demux->meta[0] = '\0';
+}
+
+static void finish_meta(icy_demux_t *demux) {
+    size_t len = demux->meta_len;
+
+    // Blocks are NUL-padded to a multiple of 16 bytes
+    while (len > 0 && demux->meta[len - 1] == '\0') {
+        len--;
+    }
+    demux->meta[len] = '\0';
+
+    if (len > 0 && demux->on_meta != NULL) {
+        demux->on_meta(demux->ctx, demux->meta, len);
+    }
+
+    demux->meta_len = 0;
+    demux->audio_left = demux->metaint;
+}
+
+void icy_demux_feed(icy_demux_t *demux, const uint8_t *data, size_t len) {
+    if (demux->metaint == 0) {
+        demux->on_audio(demux->ctx, data, len);
+        return;
+    }
+
+    while (len > 0) {
+        if (demux->audio_left > 0) {
+            // Hand out the longest audio run available in this buffer
+            size_t run = len < demux->audio_left ? len : demux->audio_left;
+            demux->on_audio(demux->ctx, data, run);
+            demux->audio_left -= run;
+            data += run;
+            len -= run;
+        } else if (demux->meta_left > 0) {
+            size_t run = len < demux->meta_left ? len : demux->meta_left;
+            memcpy(demux->meta + demux->meta_len, data, run);
+            demux->meta_len += run;
+            demux->meta_left -= run;
+            data += run;
+            len -= run;
+            if (demux->meta_left == 0) {
+                finish_meta(demux);
+            }
+        } else {
+            // Length byte; zero means "no metadata change" and is by far the common case
+            demux->meta_left = (size_t)data[0] * 16;
+            data++;
+            len--;
+            if (demux->meta_left == 0) {
+                demux->audio_left = demux->metaint;
+            }
+        }
+    }
+}
+
+// True when text starts with another "Name='" field
+static bool is_field_start(const char *text) {
+    const char *p = text;
+    while (isalpha((unsigned char)*p)) {
+        p++;
+    }
+    return p > text && p[0] == '=' && p[1] == '\'';
+}
+
+bool icy_parse_field(const char *meta, const char *key, char *out, size_t out_size) {
+    size_t key_len = strlen(key);
+    const char *p = meta;
+
+    if (out_size == 0) {
+        return false;
+    }
+
+    while ((p = strstr(p, key)) != NULL) {
+        bool at_field_start = (p == meta || p[-1] == ';');
+        if (at_field_start && p[key_len] == '=' && p[key_len + 1] == '\'') {
+            const char *value = p + key_len + 2;
+
+            // Titles may contain "';" themselves, so only a terminator followed by another field or the end counts
+            const char *end = value;
+            while ((end = strstr(end, "';")) != NULL && end[2] != '\0' && !is_field_start(end + 2)) {
+                end++;
+            }
+            if (end == NULL) {
+                end = strrchr(value, '\'');
+            }
+            if (end == NULL) {
+                return false;
+            }
+
+            size_t value_len = (size_t)(end - value);
+            if (value_len >= out_size) {
+                value_len = out_size - 1;
+            }
+            memcpy(out, value, value_len);
+            out[value_len] = '\0';
+            return true;
+        }
+        p += key_len;
+    }
+
+    return false;
+}
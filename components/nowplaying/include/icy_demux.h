@@ -0,0 +1,79 @@
+#ifndef ICY_DEMUX_H
+#define ICY_DEMUX_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Largest metadata block: the length byte counts 16-byte units */
+#define ICY_META_MAX (255 * 16)
+
+/**
+ * @brief Called with a span of audio bytes
+ *
+ * The span points into the buffer passed to icy_demux_feed(); audio is
+ * never copied by the demuxer.
+ */
+typedef void (*icy_audio_cb_t)(void *ctx, const uint8_t *data, size_t len);
+
+/**
+ * @brief Called with a complete, NUL-terminated metadata block (trailing padding removed)
+ */
+typedef void (*icy_meta_cb_t)(void *ctx, const char *meta, size_t len);
+
+/**
+ * Streaming Icecast/SHOUTcast metadata demuxer state
+ */
+typedef struct {
+    size_t metaint;    // audio bytes between metadata blocks (icy-metaint), 0 disables
+    size_t audio_left; // audio bytes until the next length byte
+    size_t meta_left;  // metadata bytes still to collect
+    size_t meta_len;   // metadata bytes collected so far
+    icy_audio_cb_t on_audio;
+    icy_meta_cb_t on_meta;
+    void *ctx;
+    char meta[ICY_META_MAX + 1];
+} icy_demux_t;
+
+/**
+ * @brief Reset demuxer for a new stream
+ *
+ * @param demux Demuxer state
+ * @param metaint Value of the icy-metaint response header, 0 if absent
+ * @param on_audio Audio span callback
+ * @param on_meta Metadata callback (can be NULL)
+ * @param ctx User context passed to callbacks
+ */
+void icy_demux_init(icy_demux_t *demux, size_t metaint, icy_audio_cb_t on_audio, icy_meta_cb_t on_meta, void *ctx);
+
+/**
+ * @brief Feed raw stream bytes
+ *
+ * Accepts any split of the stream; metadata blocks straddling calls are reassembled.
+ *
+ * @param demux Demuxer state
+ * @param data Raw bytes as received from the socket
+ * @param len Number of bytes
+ */
+void icy_demux_feed(icy_demux_t *demux, const uint8_t *data, size_t len);
+
+/**
+ * @brief Extract a quoted field from a metadata block, e.g. StreamTitle='...';
+ *
+ * @param meta Metadata block
+ * @param key Field name
+ * @param out Buffer for the value
+ * @param out_size Size of buffer
+ * @return true if the field was found
+ */
+bool icy_parse_field(const char *meta, const char *key, char *out, size_t out_size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ICY_DEMUX_H
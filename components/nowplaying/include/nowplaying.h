@@ -0,0 +1,77 @@
+#ifndef NOWPLAYING_H
+#define NOWPLAYING_H
+
+#include "esp_err.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define NOWPLAYING_TEXT_MAX 128 // title/station/url buffer size
+#define NOWPLAYING_HISTORY  8   // previous titles kept
+
+/**
+ * @brief Initialize now-playing cache
+ *
+ * Subscribes to EVENT_STREAM_STATE, so call after event_bus_init().
+ *
+ * @return esp_err_t ESP_OK on success
+ */
+esp_err_t nowplaying_init(void);
+
+/**
+ * @brief Set current station, clears the title
+ *
+ * @param name Station name (can be NULL)
+ * @param stream_url Stream URL (can be NULL)
+ */
+void nowplaying_set_station(const char *name, const char *stream_url);
+
+/**
+ * @brief Set current title, the previous one moves into history
+ *
+ * Repeated titles (stations resend metadata periodically) are ignored.
+ *
+ * @param title Track title
+ */
+void nowplaying_set_title(const char *title);
+
+/**
+ * @brief icy_meta_cb_t adapter: parses StreamTitle and updates the title
+ */
+void nowplaying_icy_meta_cb(void *ctx, const char *meta, size_t len);
+
+/**
+ * @brief Copy current station name and title
+ *
+ * @param station Buffer for the station name
+ * @param station_size Size of station buffer
+ * @param title Buffer for the title
+ * @param title_size Size of title buffer
+ */
+void nowplaying_get_current(char *station, size_t station_size, char *title, size_t title_size);
+
+/**
+ * @brief Get cache version, incremented on every change
+ *
+ * @return uint32_t Version usable as an ETag
+ */
+uint32_t nowplaying_version(void);
+
+/**
+ * @brief Render the cache as JSON
+ *
+ * @param buffer Output buffer
+ * @param buffer_size Size of buffer
+ * @param version Pointer to store the version the JSON was rendered from (can be NULL)
+ * @return size_t JSON length, 0 if the buffer was too small
+ */
+size_t nowplaying_to_json(char *buffer, size_t buffer_size, uint32_t *version);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // NOWPLAYING_H
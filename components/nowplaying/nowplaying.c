@@ -0,0 +1,206 @@
+#include "nowplaying.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "event_bus.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "icy_demux.h"
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+static const char *const TAG = "NOWPLAYING";
+
+#define LISTENER_TASK_STACK_SIZE 2560
+#define LISTENER_TASK_PRIORITY   2
+
+typedef struct {
+    char title[NOWPLAYING_TEXT_MAX];
+    uint32_t since; // uptime seconds when the title started
+} nowplaying_entry_t;
+
+static SemaphoreHandle_t lock = NULL;
+static uint32_t version = 0;
+static char station[NOWPLAYING_TEXT_MAX];
+static char url[NOWPLAYING_TEXT_MAX];
+static nowplaying_entry_t current;
+static nowplaying_entry_t history[NOWPLAYING_HISTORY]; // ring, history_head is the newest
+static size_t history_head = 0;
+static size_t history_count = 0;
+static bool playing = false;      // audio output is streaming, from EVENT_STREAM_STATE
+static uint32_t sample_rate = 0;  // device rate of the running stream
+
+typedef struct {
+    char *buf;
+    size_t size;
+    size_t len;
+    bool overflow;
+} json_writer_t;
+
+static void json_raw(json_writer_t *w, const char *fmt, ...) {
+    if (w->overflow) {
+        return;
+    }
+    va_list args;
+    va_start(args, fmt);
+    int n = vsnprintf(w->buf + w->len, w->size - w->len, fmt, args);
+    va_end(args);
+    if (n < 0 || (size_t)n >= w->size - w->len) {
+        w->overflow = true;
+        return;
+    }
+    w->len += n;
+}
+
+static void json_string(json_writer_t *w, const char *s) {
+    json_raw(w, "\"");
+    for (; *s != '\0' && !w->overflow; s++) {
+        unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\') {
+            json_raw(w, "\\%c", c);
+        } else if (c < 0x20) {
+            json_raw(w, "\\u%04x", c);
+        } else {
+            json_raw(w, "%c", c);
+        }
+    }
+    json_raw(w, "\"");
+}
+
+static uint32_t uptime_seconds(void) {
+    return (uint32_t)(esp_timer_get_time() / 1000000);
+}
+
+// Follows the audio output's stream state, so /api/nowplaying clients see playback start and stop through the ETag
+static void stream_listener_task(void *arg) {
+    event_bus_subscriber_t *sub = (event_bus_subscriber_t *)arg;
+    event_t event;
+
+    while (1) {
+        if (!event_bus_receive(sub, &event, portMAX_DELAY) || event.id != EVENT_STREAM_STATE) {
+            continue;
+        }
+
+        xSemaphoreTake(lock, portMAX_DELAY);
+        uint32_t rate = event.stream_state.active ? event.stream_state.sample_rate : 0;
+        if (playing != event.stream_state.active || sample_rate != rate) {
+            playing = event.stream_state.active;
+            sample_rate = rate;
+            version++;
+        }
+        xSemaphoreGive(lock);
+    }
+}
+
+esp_err_t nowplaying_init(void) {
+    if (lock == NULL) {
+        lock = xSemaphoreCreateMutex();
+        if (lock == NULL) {
+            ESP_LOGE(TAG, "Failed to create mutex");
+            return ESP_ERR_NO_MEM;
+        }
+
+        event_bus_subscriber_t *sub = event_bus_subscribe("nowplaying", EVENT_MASK(EVENT_STREAM_STATE));
+        if (sub == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+        if (xTaskCreate(stream_listener_task, "nowplaying", LISTENER_TASK_STACK_SIZE, sub, LISTENER_TASK_PRIORITY,
+                        NULL) != pdPASS) {
+            ESP_LOGE(TAG, "Failed to create stream listener task");
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    ESP_LOGI(TAG, "Now-playing cache initialized (%d history entries)", NOWPLAYING_HISTORY);
+    return ESP_OK;
+}
+
+void nowplaying_set_station(const char *name, const char *stream_url) {
+    xSemaphoreTake(lock, portMAX_DELAY);
+    snprintf(station, sizeof(station), "%s", name != NULL ? name : "");
+    snprintf(url, sizeof(url), "%s", stream_url != NULL ? stream_url : "");
+    current.title[0] = '\0';
+    current.since = uptime_seconds();
+    history_count = 0;
+    version++;
+    xSemaphoreGive(lock);
+
+    ESP_LOGI(TAG, "Station: %s", station);
+}
+
+void nowplaying_set_title(const char *title) {
+    if (title == NULL) {
+        return;
+    }
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+    if (strncmp(current.title, title, sizeof(current.title) - 1) == 0) {
+        xSemaphoreGive(lock);
+        return;
+    }
+
+    if (current.title[0] != '\0') {
+        history_head = (history_head + 1) % NOWPLAYING_HISTORY;
+        history[history_head] = current;
+        if (history_count < NOWPLAYING_HISTORY) {
+            history_count++;
+        }
+    }
+
+    snprintf(current.title, sizeof(current.title), "%s", title);
+    current.since = uptime_seconds();
+    version++;
+    xSemaphoreGive(lock);
+
+    ESP_LOGI(TAG, "Now playing: %s", title);
+}
+
+void nowplaying_icy_meta_cb(void *ctx, const char *meta, size_t len) {
+    char title[NOWPLAYING_TEXT_MAX];
+    if (icy_parse_field(meta, "StreamTitle", title, sizeof(title))) {
+        nowplaying_set_title(title);
+    }
+}
+
+void nowplaying_get_current(char *station_out, size_t station_size, char *title_out, size_t title_size) {
+    xSemaphoreTake(lock, portMAX_DELAY);
+    snprintf(station_out, station_size, "%s", station);
+    snprintf(title_out, title_size, "%s", current.title);
+    xSemaphoreGive(lock);
+}
+
+uint32_t nowplaying_version(void) {
+    return version;
+}
+
+size_t nowplaying_to_json(char *buffer, size_t buffer_size, uint32_t *rendered_version) {
+    json_writer_t w = {.buf = buffer, .size = buffer_size, .len = 0, .overflow = false};
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+
+    json_raw(&w, "{\"version\":%lu,\"playing\":%s,\"sample_rate\":%lu,\"station\":", (unsigned long)version,
+             playing ? "true" : "false", (unsigned long)sample_rate);
+    json_string(&w, station);
+    json_raw(&w, ",\"url\":");
+    json_string(&w, url);
+    json_raw(&w, ",\"title\":");
+    json_string(&w, current.title);
+    json_raw(&w, ",\"since\":%lu,\"history\":[", (unsigned long)current.since);
+    for (size_t i = 0; i < history_count; i++) {
+        const nowplaying_entry_t *entry = &history[(history_head + NOWPLAYING_HISTORY - i) % NOWPLAYING_HISTORY];
+        json_raw(&w, i == 0 ? "{\"title\":" : ",{\"title\":");
+        json_string(&w, entry->title);
+        json_raw(&w, ",\"since\":%lu}", (unsigned long)entry->since);
+    }
+    json_raw(&w, "]}");
+
+    if (rendered_version != NULL) {
+        *rendered_version = version;
+    }
+
+    xSemaphoreGive(lock);
+
+    return w.overflow ? 0 : w.len;
+}
@@ -1,6 +1,7 @@
 #include "nvs.h"
 #include "esp_log.h"
 #include "nvs_flash.h"
+#include "trace.h"
 #include <string.h>
 
 static const char *const TAG = "NVS";
@@ -21,6 +22,8 @@ esp_err_t nvs_init(void) {
 }
 
 esp_err_t nvs_cache_put_str(const char *key, const char *value) {
+    TRACE_SCOPE("nvs_cache_put_str");
+
     nvs_handle_t handle;
     esp_err_t ret;
 
@@ -37,7 +40,9 @@ esp_err_t nvs_cache_put_str(const char *key, const char *value) {
         return ret;
     }
 
+    TRACE_SPAN_BEGIN(commit_span, "nvs_commit");
     ret = nvs_commit(handle);
+    TRACE_SPAN_END(commit_span);
     nvs_close(handle);
 
     if (ret == ESP_OK) {
@@ -48,6 +53,8 @@ esp_err_t nvs_cache_put_str(const char *key, const char *value) {
 }
 
 esp_err_t nvs_cache_get_str(const char *key, char *value, size_t max_len) {
+    TRACE_SCOPE("nvs_cache_get_str");
+
     nvs_handle_t handle;
     esp_err_t ret;
     size_t required_size = max_len;
@@ -73,6 +80,8 @@ esp_err_t nvs_cache_get_str(const char *key, char *value, size_t max_len) {
 }
 
 esp_err_t nvs_cache_put_i32(const char *key, int32_t value) {
+    TRACE_SCOPE("nvs_cache_put_i32");
+
     nvs_handle_t handle;
     esp_err_t ret;
 
@@ -89,7 +98,9 @@ esp_err_t nvs_cache_put_i32(const char *key, int32_t value) {
         return ret;
     }
 
+    TRACE_SPAN_BEGIN(commit_span, "nvs_commit");
     ret = nvs_commit(handle);
+    TRACE_SPAN_END(commit_span);
     nvs_close(handle);
 
     if (ret == ESP_OK) {
@@ -100,6 +111,8 @@ esp_err_t nvs_cache_put_i32(const char *key, int32_t value) {
 }
 
 esp_err_t nvs_cache_get_i32(const char *key, int32_t *value) {
+    TRACE_SCOPE("nvs_cache_get_i32");
+
     nvs_handle_t handle;
     esp_err_t ret;
 
@@ -128,6 +141,8 @@ esp_err_t nvs_cache_get_i32(const char *key, int32_t *value) {
 }
 
 esp_err_t nvs_cache_forget(const char *key) {
+    TRACE_SCOPE("nvs_cache_forget");
+
     nvs_handle_t handle;
     esp_err_t ret;
 
@@ -144,7 +159,9 @@ esp_err_t nvs_cache_forget(const char *key) {
         return ret;
     }
 
+    TRACE_SPAN_BEGIN(commit_span, "nvs_commit");
     ret = nvs_commit(handle);
+    TRACE_SPAN_END(commit_span);
     nvs_close(handle);
 
     if (ret == ESP_OK) {
@@ -155,6 +172,8 @@ esp_err_t nvs_cache_forget(const char *key) {
 }
 
 esp_err_t nvs_cache_flush(void) {
+    TRACE_SCOPE("nvs_cache_flush");
+
     nvs_handle_t handle;
     esp_err_t ret;
 
@@ -164,7 +183,9 @@ esp_err_t nvs_cache_flush(void) {
         return ret;
     }
 
+    TRACE_SPAN_BEGIN(commit_span, "nvs_commit");
     ret = nvs_commit(handle);
+    TRACE_SPAN_END(commit_span);
     nvs_close(handle);
 
     if (ret == ESP_OK) {
@@ -0,0 +1,98 @@
+#ifndef POWER_H
+#define POWER_H
+
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Power states, derived from connected stations and active work
+ */
+typedef enum {
+    POWER_STATE_SLEEP = 0, // no stations, no work: DFS + automatic light sleep
+    POWER_STATE_IDLE,      // stations connected, no work: DFS only
+    POWER_STATE_ACTIVE,    // HTTP request or audio stream in progress: max CPU frequency
+    POWER_STATE_MAX,
+} power_state_t;
+
+/**
+ * @brief Configure dynamic frequency scaling and create PM locks
+ *
+ * Works without CONFIG_PM_ENABLE, in which case only statistics are kept.
+ * Registers a WIFI_EVENT handler, so call this after access_point_init()
+ * has created the default event loop.
+ *
+ * @return esp_err_t ESP_OK on success
+ */
+esp_err_t power_init(void);
+
+/**
+ * @brief Note a new client connection (call from the HTTP server open callback)
+ *
+ * The first connection after an idle period starts a wake latency measurement.
+ */
+void power_connection_opened(void);
+
+/**
+ * @brief Hold max CPU frequency and block light sleep for an HTTP request
+ */
+void power_request_begin(void);
+
+/**
+ * @brief Release the HTTP request lock
+ */
+void power_request_end(void);
+
+/**
+ * @brief Hold APB frequency and block light sleep while audio is streaming
+ */
+void power_stream_begin(void);
+
+/**
+ * @brief Release the audio stream lock
+ */
+void power_stream_end(void);
+
+/**
+ * @brief Block until the power state changes
+ *
+ * @param timeout Ticks to wait
+ * @return power_state_t Current state
+ */
+power_state_t power_wait_state_change(TickType_t timeout);
+
+/**
+ * @brief Get state name for logging
+ *
+ * @param state Power state
+ * @return const char* Name
+ */
+const char *power_state_name(power_state_t state);
+
+/**
+ * @brief Log time per state, estimated current and wake latency
+ *
+ * The current estimate weights the POWER_EST_*_MA constants by time per
+ * state. With CONFIG_PM_PROFILING the esp_pm lock and mode statistics are
+ * dumped as well.
+ */
+void power_log_stats(void);
+
+/**
+ * @brief Render statistics as JSON
+ *
+ * @param buffer Output buffer
+ * @param buffer_size Size of buffer
+ * @return size_t JSON length, 0 if the buffer was too small
+ */
+size_t power_to_json(char *buffer, size_t buffer_size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // POWER_H
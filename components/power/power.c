@@ -0,0 +1,356 @@
+#include "power.h"
+#include "esp_bit_defs.h"
+#include "esp_event.h"
+#include "esp_log.h"
+#include "esp_pm.h"
+#include "esp_timer.h"
+#include "esp_wifi.h"
+#include "freertos/event_groups.h"
+#include "freertos/semphr.h"
+#include "radio_wazoo_config.h"
+#include "sdkconfig.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+static const char *const TAG = "POWER";
+
+#define STATE_CHANGED_BIT BIT0
+
+static const char *const state_names[POWER_STATE_MAX] = {"sleep", "idle", "active"};
+// Fixed guesses per state, not measured: esp_pm exposes no per-mode times without CONFIG_PM_PROFILING
+static const uint32_t state_current_ma[POWER_STATE_MAX] = {POWER_EST_SLEEP_MA, POWER_EST_IDLE_MA,
+                                                           POWER_EST_ACTIVE_MA};
+
+static portMUX_TYPE state_lock = portMUX_INITIALIZER_UNLOCKED;
+static EventGroupHandle_t state_events = NULL;
+static bool pm_enabled = false;
+static SemaphoreHandle_t pm_mutex = NULL; // serialises esp_pm_configure calls
+static bool pm_light_sleep = false;       // last applied setting, guarded by pm_mutex
+
+#if CONFIG_PM_ENABLE
+static esp_pm_lock_handle_t request_cpu_lock = NULL;
+static esp_pm_lock_handle_t stream_apb_lock = NULL;
+static esp_pm_lock_handle_t no_sleep_lock = NULL;
+#endif
+
+static int stations = 0;
+static int requests = 0;
+static int streams = 0;
+static power_state_t state = POWER_STATE_SLEEP;
+static int64_t state_since_us = 0;
+static int64_t time_in_state_us[POWER_STATE_MAX];
+
+static int64_t last_activity_us = 0;
+static int64_t pending_open_us = 0; // connection that woke us up, 0 if none
+
+static uint32_t wake_count = 0;
+static int64_t wake_last_us = 0;
+static int64_t wake_max_us = 0;
+static int64_t wake_total_us = 0;
+
+static esp_err_t configure_pm(bool light_sleep) {
+    if (!pm_enabled) {
+        return ESP_OK;
+    }
+
+    esp_pm_config_t pm_config = {
+        .max_freq_mhz = POWER_CPU_MAX_MHZ,
+        .min_freq_mhz = POWER_CPU_MIN_MHZ,
+        .light_sleep_enable = light_sleep,
+    };
+
+    esp_err_t ret = esp_pm_configure(&pm_config);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to configure PM (light sleep %s): %s", light_sleep ? "on" : "off",
+                 esp_err_to_name(ret));
+    }
+    return ret;
+}
+
+// Must be called with state_lock held; returns true if the state changed
+static bool update_state_locked(int64_t now) {
+    power_state_t next = POWER_STATE_SLEEP;
+    if (requests > 0 || streams > 0) {
+        next = POWER_STATE_ACTIVE;
+    } else if (stations > 0) {
+        next = POWER_STATE_IDLE;
+    }
+
+    if (next == state) {
+        return false;
+    }
+
+    time_in_state_us[state] += now - state_since_us;
+    state_since_us = now;
+    state = next;
+    return true;
+}
+
+// Called after every state change. Two tasks can change the state at once, so the light sleep
+// setting is taken from the latest state under pm_mutex rather than from the caller's change;
+// whichever call applies last, it applies the current state.
+static void apply_state(void) {
+    if (pm_mutex != NULL) {
+        xSemaphoreTake(pm_mutex, portMAX_DELAY);
+        taskENTER_CRITICAL(&state_lock);
+        bool light_sleep = state == POWER_STATE_SLEEP;
+        taskEXIT_CRITICAL(&state_lock);
+        if (light_sleep != pm_light_sleep && configure_pm(light_sleep) == ESP_OK) {
+            pm_light_sleep = light_sleep;
+        }
+        xSemaphoreGive(pm_mutex);
+    }
+    if (state_events != NULL) {
+        xEventGroupSetBits(state_events, STATE_CHANGED_BIT);
+    }
+}
+
+// Re-reads the count from the driver instead of counting events, so a missed event cannot leave it wrong
+static void update_stations(void) {
+    wifi_sta_list_t list;
+    int count = esp_wifi_ap_get_sta_list(&list) == ESP_OK ? list.num : 0;
+    int64_t now = esp_timer_get_time();
+    bool changed = false;
+
+    taskENTER_CRITICAL(&state_lock);
+    if (count != stations) {
+        stations = count;
+        changed = update_state_locked(now);
+    }
+    taskEXIT_CRITICAL(&state_lock);
+
+    if (changed) {
+        apply_state();
+    }
+}
+
+static void wifi_event_handler(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data) {
+    if (event_id == WIFI_EVENT_AP_STACONNECTED || event_id == WIFI_EVENT_AP_STADISCONNECTED ||
+        event_id == WIFI_EVENT_AP_START || event_id == WIFI_EVENT_AP_STOP) {
+        update_stations();
+    }
+}
+
+esp_err_t power_init(void) {
+    state_events = xEventGroupCreate();
+    pm_mutex = xSemaphoreCreateMutex();
+    if (state_events == NULL || pm_mutex == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    state_since_us = esp_timer_get_time();
+    last_activity_us = state_since_us;
+
+#if CONFIG_PM_ENABLE
+    ESP_ERROR_CHECK(esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, "http", &request_cpu_lock));
+    ESP_ERROR_CHECK(esp_pm_lock_create(ESP_PM_APB_FREQ_MAX, 0, "audio", &stream_apb_lock));
+    ESP_ERROR_CHECK(esp_pm_lock_create(ESP_PM_NO_LIGHT_SLEEP, 0, "busy", &no_sleep_lock));
+    pm_enabled = true;
+    pm_light_sleep = configure_pm(true) == ESP_OK;
+    ESP_LOGI(TAG, "DFS %d-%d MHz, light sleep while no stations are connected", POWER_CPU_MIN_MHZ,
+             POWER_CPU_MAX_MHZ);
+#else
+    ESP_LOGW(TAG, "CONFIG_PM_ENABLE is off, running at fixed frequency (statistics only)");
+#endif
+
+    esp_err_t ret = esp_event_handler_register(WIFI_EVENT, ESP_EVENT_ANY_ID, &wifi_event_handler, NULL);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to register WiFi event handler: %s", esp_err_to_name(ret));
+        return ret;
+    }
+    // Stations may have joined before the handler was registered
+    update_stations();
+
+    return ESP_OK;
+}
+
+void power_connection_opened(void) {
+    int64_t now = esp_timer_get_time();
+
+    taskENTER_CRITICAL(&state_lock);
+    if (requests == 0 && pending_open_us == 0 && now - last_activity_us > POWER_IDLE_AFTER_MS * 1000LL) {
+        pending_open_us = now;
+    }
+    taskEXIT_CRITICAL(&state_lock);
+}
+
+void power_request_begin(void) {
+#if CONFIG_PM_ENABLE
+    if (pm_enabled) {
+        esp_pm_lock_acquire(request_cpu_lock);
+        esp_pm_lock_acquire(no_sleep_lock);
+    }
+#endif
+
+    int64_t now = esp_timer_get_time();
+    bool changed;
+
+    taskENTER_CRITICAL(&state_lock);
+    if (pending_open_us != 0) {
+        // Connection accepted to handler running, the user-visible cost of having been idle
+        int64_t latency = now - pending_open_us;
+        pending_open_us = 0;
+        wake_count++;
+        wake_last_us = latency;
+        wake_total_us += latency;
+        if (latency > wake_max_us) {
+            wake_max_us = latency;
+        }
+    }
+    requests++;
+    last_activity_us = now;
+    changed = update_state_locked(now);
+    taskEXIT_CRITICAL(&state_lock);
+
+    if (changed) {
+        apply_state();
+    }
+}
+
+void power_request_end(void) {
+    int64_t now = esp_timer_get_time();
+    bool changed;
+
+    taskENTER_CRITICAL(&state_lock);
+    if (requests > 0) {
+        requests--;
+    }
+    last_activity_us = now;
+    changed = update_state_locked(now);
+    taskEXIT_CRITICAL(&state_lock);
+
+    if (changed) {
+        apply_state();
+    }
+
+#if CONFIG_PM_ENABLE
+    if (pm_enabled) {
+        esp_pm_lock_release(no_sleep_lock);
+        esp_pm_lock_release(request_cpu_lock);
+    }
+#endif
+}
+
+void power_stream_begin(void) {
+#if CONFIG_PM_ENABLE
+    if (pm_enabled) {
+        esp_pm_lock_acquire(stream_apb_lock);
+        esp_pm_lock_acquire(no_sleep_lock);
+    }
+#endif
+
+    int64_t now = esp_timer_get_time();
+    bool changed;
+
+    taskENTER_CRITICAL(&state_lock);
+    streams++;
+    changed = update_state_locked(now);
+    taskEXIT_CRITICAL(&state_lock);
+
+    if (changed) {
+        apply_state();
+    }
+}
+
+void power_stream_end(void) {
+    int64_t now = esp_timer_get_time();
+    bool changed;
+
+    taskENTER_CRITICAL(&state_lock);
+    if (streams > 0) {
+        streams--;
+    }
+    changed = update_state_locked(now);
+    taskEXIT_CRITICAL(&state_lock);
+
+    if (changed) {
+        apply_state();
+    }
+
+#if CONFIG_PM_ENABLE
+    if (pm_enabled) {
+        esp_pm_lock_release(no_sleep_lock);
+        esp_pm_lock_release(stream_apb_lock);
+    }
+#endif
+}
+
+power_state_t power_wait_state_change(TickType_t timeout) {
+    xEventGroupWaitBits(state_events, STATE_CHANGED_BIT, pdTRUE, pdFALSE, timeout);
+    return state;
+}
+
+const char *power_state_name(power_state_t s) {
+    return s < POWER_STATE_MAX ? state_names[s] : "unknown";
+}
+
+typedef struct {
+    int64_t time_us[POWER_STATE_MAX];
+    int64_t total_us;
+    uint32_t estimate_ma;
+    uint32_t wake_count;
+    int64_t wake_last_us;
+    int64_t wake_max_us;
+    int64_t wake_avg_us;
+    int stations;
+    power_state_t state;
+} power_stats_t;
+
+static void snapshot(power_stats_t *out) {
+    int64_t now = esp_timer_get_time();
+
+    taskENTER_CRITICAL(&state_lock);
+    for (int i = 0; i < POWER_STATE_MAX; i++) {
+        out->time_us[i] = time_in_state_us[i];
+    }
+    out->time_us[state] += now - state_since_us;
+    out->wake_count = wake_count;
+    out->wake_last_us = wake_last_us;
+    out->wake_max_us = wake_max_us;
+    out->wake_avg_us = wake_count > 0 ? wake_total_us / wake_count : 0;
+    out->stations = stations;
+    out->state = state;
+    taskEXIT_CRITICAL(&state_lock);
+
+    // Time-weighted average of the per-state current estimates
+    int64_t weighted = 0;
+    out->total_us = 0;
+    for (int i = 0; i < POWER_STATE_MAX; i++) {
+        out->total_us += out->time_us[i];
+        weighted += out->time_us[i] * state_current_ma[i];
+    }
+    out->estimate_ma = out->total_us > 0 ? (uint32_t)(weighted / out->total_us) : 0;
+}
+
+void power_log_stats(void) {
+    power_stats_t stats;
+    snapshot(&stats);
+
+    ESP_LOGI(TAG, "State %s, %d station(s); time sleep/idle/active: %lld/%lld/%lld s", state_names[stats.state],
+             stats.stations, stats.time_us[POWER_STATE_SLEEP] / 1000000, stats.time_us[POWER_STATE_IDLE] / 1000000,
+             stats.time_us[POWER_STATE_ACTIVE] / 1000000);
+    ESP_LOGI(TAG, "Estimated average current: %lu mA; wake latency last/avg/max: %lld/%lld/%lld us (%lu wakes)",
+             (unsigned long)stats.estimate_ma, stats.wake_last_us, stats.wake_avg_us, stats.wake_max_us,
+             (unsigned long)stats.wake_count);
+
+#if CONFIG_PM_PROFILING
+    esp_pm_dump_locks(stdout);
+#endif
+}
+
+size_t power_to_json(char *buffer, size_t buffer_size) {
+    power_stats_t stats;
+    snapshot(&stats);
+
+    int n = snprintf(buffer, buffer_size,
+                     "{\"state\":\"%s\",\"stations\":%d,\"pm\":%s,\"time_ms\":{\"sleep\":%lld,\"idle\":%lld,"
+                     "\"active\":%lld},\"estimated_ma\":%lu,\"wake\":{\"count\":%lu,\"last_us\":%lld,"
+                     "\"avg_us\":%lld,\"max_us\":%lld}}",
+                     state_names[stats.state], stats.stations, pm_enabled ? "true" : "false",
+                     stats.time_us[POWER_STATE_SLEEP] / 1000, stats.time_us[POWER_STATE_IDLE] / 1000,
+                     stats.time_us[POWER_STATE_ACTIVE] / 1000, (unsigned long)stats.estimate_ma,
+                     (unsigned long)stats.wake_count, stats.wake_last_us, stats.wake_avg_us, stats.wake_max_us);
+
+    return (n < 0 || (size_t)n >= buffer_size) ? 0 : (size_t)n;
+}
@@ -2,18 +2,51 @@
 #define SETTINGS_H
 
 #include "esp_err.h"
+#include <stddef.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+#define SETTINGS_MAX       16
+#define SETTINGS_VALUE_MAX 65 // a 64-hex-digit WPA2 PSK plus the terminator
+
 /**
  * @brief Initialize Settings storage
  *
+ * Loads defaults from the embedded settings.default.csv, then applies any
+ * values previously saved to NVS.
+ *
  * @return esp_err_t ESP_OK on success
  */
 esp_err_t settings_init(void);
 
+/**
+ * @brief Get a setting value
+ *
+ * @param scope Scope name, e.g. "Network"
+ * @param name Setting name, e.g. "SSID"
+ * @param value Buffer to store the value
+ * @param max_len Size of buffer
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NOT_FOUND if the setting is not defined
+ */
+esp_err_t settings_get_str(const char *scope, const char *name, char *value, size_t max_len);
+
+/**
+ * @brief Change a setting and save it to NVS
+ *
+ * Publishes EVENT_SETTING_CHANGED with the setting's NVS key. Settings are
+ * read once by their consumers at startup, so the Network settings only
+ * take effect after a reboot.
+ *
+ * @param scope Scope name
+ * @param name Setting name
+ * @param value New value, shorter than SETTINGS_VALUE_MAX
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NOT_FOUND if the setting is not defined,
+ *         ESP_ERR_INVALID_SIZE if the value is too long
+ */
+esp_err_t settings_set_str(const char *scope, const char *name, const char *value);
+
 #ifdef __cplusplus
 }
 #endif
@@ -1,12 +1,191 @@
 #include "settings.h"
 #include "esp_log.h"
+#include "event_bus.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "nvs.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
 
 static const char *const TAG = "SETTINGS";
 
+#define SETTINGS_SCOPE_MAX 16
+#define SETTINGS_NAME_MAX  24
+#define SETTINGS_TYPE_MAX  8
+
+extern const char settings_csv_start[] asm("_binary_settings_default_csv_start");
+
+typedef struct {
+    char scope[SETTINGS_SCOPE_MAX];
+    char name[SETTINGS_NAME_MAX];
+    char type[SETTINGS_TYPE_MAX];
+    char value[SETTINGS_VALUE_MAX];
+    char key[EVENT_KEY_MAX]; // NVS key, also sent with change events
+} setting_t;
+
+static setting_t settings[SETTINGS_MAX];
+static size_t settings_count = 0;
+static SemaphoreHandle_t lock = NULL;
+
+// Copy field [start, end) into out with surrounding whitespace removed
+static void copy_trimmed(char *out, size_t out_size, const char *start, const char *end) {
+    while (start < end && isspace((unsigned char)*start)) {
+        start++;
+    }
+    while (end > start && isspace((unsigned char)end[-1])) {
+        end--;
+    }
+
+    size_t len = (size_t)(end - start);
+    if (len >= out_size) {
+        len = out_size - 1;
+    }
+    memcpy(out, start, len);
+    out[len] = '\0';
+}
+
+// NVS keys are limited to 15 characters: "net.password" for Network/Password
+static void make_key(char *key, size_t key_size, const char *scope, const char *name) {
+    snprintf(key, key_size, "%.3s.%s", scope, name);
+    for (char *p = key; *p != '\0'; p++) {
+        *p = (char)tolower((unsigned char)*p);
+    }
+}
+
+// Parse one "Scope, Name, Type, Value" line; comments and blank lines are skipped
+static void parse_line(const char *line, const char *end) {
+    const char *fields[4];
+    const char *field_ends[4];
+    int count = 0;
+
+    while (line < end && isspace((unsigned char)*line)) {
+        line++;
+    }
+    if (line == end || *line == '#') {
+        return;
+    }
+
+    fields[0] = line;
+    for (const char *p = line; p < end && count < 4; p++) {
+        if (*p == ',' && count < 3) {
+            field_ends[count++] = p;
+            fields[count] = p + 1;
+        }
+    }
+    field_ends[count++] = end;
+
+    if (count < 3) {
+        ESP_LOGW(TAG, "Malformed settings line skipped");
+        return;
+    }
+    if (settings_count >= SETTINGS_MAX) {
+        ESP_LOGW(TAG, "Too many settings, increase SETTINGS_MAX");
+        return;
+    }
+
+    setting_t *s = &settings[settings_count++];
+    copy_trimmed(s->scope, sizeof(s->scope), fields[0], field_ends[0]);
+    copy_trimmed(s->name, sizeof(s->name), fields[1], field_ends[1]);
+    copy_trimmed(s->type, sizeof(s->type), fields[2], field_ends[2]);
+    if (count > 3) {
+        copy_trimmed(s->value, sizeof(s->value), fields[3], field_ends[3]);
+    } else {
+        s->value[0] = '\0';
+    }
+    make_key(s->key, sizeof(s->key), s->scope, s->name);
+}
+
+static setting_t *find(const char *scope, const char *name) {
+    for (size_t i = 0; i < settings_count; i++) {
+        if (strcasecmp(settings[i].scope, scope) == 0 && strcasecmp(settings[i].name, name) == 0) {
+            return &settings[i];
+        }
+    }
+    return NULL;
+}
+
 esp_err_t settings_init(void) {
-    // esp_err_t ret;
+    if (lock == NULL) {
+        lock = xSemaphoreCreateMutex();
+        if (lock == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    settings_count = 0;
+    const char *line = settings_csv_start;
+    while (*line != '\0') {
+        const char *end = strchr(line, '\n');
+        if (end == NULL) {
+            end = line + strlen(line);
+        }
+        parse_line(line, end > line && end[-1] == '\r' ? end - 1 : end);
+        line = *end != '\0' ? end + 1 : end;
+    }
+
+    // Saved values take precedence over the defaults
+    size_t overrides = 0;
+    for (size_t i = 0; i < settings_count; i++) {
+        char value[SETTINGS_VALUE_MAX];
+        if (nvs_cache_get_str(settings[i].key, value, sizeof(value)) == ESP_OK) {
+            snprintf(settings[i].value, sizeof(settings[i].value), "%s", value);
+            overrides++;
+        }
+    }
+
+    ESP_LOGI(TAG, "Settings storage Successfully initialized (%d settings, %d from NVS)", settings_count, overrides);
+
+    return ESP_OK;
+}
+
+esp_err_t settings_get_str(const char *scope, const char *name, char *value, size_t max_len) {
+    if (scope == NULL || name == NULL || value == NULL || max_len == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t ret = ESP_ERR_NOT_FOUND;
+    xSemaphoreTake(lock, portMAX_DELAY);
+    setting_t *s = find(scope, name);
+    if (s != NULL) {
+        snprintf(value, max_len, "%s", s->value);
+        ret = ESP_OK;
+    }
+    xSemaphoreGive(lock);
+
+    return ret;
+}
+
+esp_err_t settings_set_str(const char *scope, const char *name, const char *value) {
+    if (scope == NULL || name == NULL || value == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    // Refuse rather than store a cut-off password
+    if (strlen(value) >= SETTINGS_VALUE_MAX) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    event_setting_t event;
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+    setting_t *s = find(scope, name);
+    if (s == NULL) {
+        xSemaphoreGive(lock);
+        return ESP_ERR_NOT_FOUND;
+    }
+    esp_err_t ret = nvs_cache_put_str(s->key, value);
+    if (ret == ESP_OK) {
+        snprintf(s->value, sizeof(s->value), "%s", value);
+        snprintf(event.key, sizeof(event.key), "%s", s->key);
+    }
+    xSemaphoreGive(lock);
 
-    ESP_LOGI(TAG, "Settings storage Successfully initialized...");
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to save %s/%s: %s", scope, name, esp_err_to_name(ret));
+        return ret;
+    }
 
+    ESP_LOGI(TAG, "Setting %s/%s changed", scope, name);
+    event_bus_publish_setting_changed(&event);
     return ESP_OK;
 }
@@ -0,0 +1,101 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "esp_err.h"
+#include "sdkconfig.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if CONFIG_TRACE_ENABLE
+
+/**
+ * An open span, lives on the caller's stack until TRACE_SPAN_END
+ */
+typedef struct {
+    const char *name; // must outlive the trace, use string literals
+    const char *arg;  // optional detail, copied when the span ends
+    int64_t start_us; // esp_timer_get_time()
+} trace_span_t;
+
+/**
+ * Sink for exported JSON, e.g. a chunked HTTP response
+ */
+typedef esp_err_t (*trace_write_fn)(void *ctx, const char *data, size_t len);
+
+/**
+ * @brief Open a span
+ *
+ * @param name Span name, must be a string literal
+ * @return trace_span_t Span to pass to trace_span_end()
+ */
+trace_span_t trace_span_begin(const char *name);
+
+/**
+ * @brief Open a span carrying a detail string, e.g. a request URI
+ *
+ * The string only has to stay valid until the span ends; it is copied
+ * then and cut to TRACE_ARG_SIZE - 1 bytes.
+ *
+ * @param name Span name, must be a string literal
+ * @param arg Detail shown as args.detail in the trace viewer
+ * @return trace_span_t Span to pass to trace_span_end()
+ */
+trace_span_t trace_span_begin_arg(const char *name, const char *arg);
+
+/**
+ * @brief Close a span and record it in the calling task's ring
+ *
+ * Spans are dropped if every ring is already owned by another task. A ring
+ * is released when its task is deleted (needs
+ * CONFIG_FREERTOS_TLSP_DELETION_CALLBACKS) and handed to the next task
+ * that records a span.
+ *
+ * @param span Span returned by trace_span_begin()
+ */
+void trace_span_end(trace_span_t *span);
+
+/**
+ * @brief Write all recorded spans as Chrome trace-event JSON
+ *
+ * Loads in chrome://tracing and ui.perfetto.dev, one track per task.
+ *
+ * @param write Output callback, called with pieces of at most a few hundred bytes
+ * @param ctx Callback context
+ * @return esp_err_t ESP_OK, or the first error returned by the callback
+ */
+esp_err_t trace_export(trace_write_fn write, void *ctx);
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b)  TRACE_CONCAT_(a, b)
+
+// Explicit span: TRACE_SPAN_BEGIN(open, "fopen"); ... TRACE_SPAN_END(open);
+#define TRACE_SPAN_BEGIN(span, name) trace_span_t span = trace_span_begin(name)
+#define TRACE_SPAN_END(span)         trace_span_end(&span)
+
+// Span covering the rest of the enclosing block, closed on every return path
+#define TRACE_SCOPE(name)                                                                                              \
+    trace_span_t TRACE_CONCAT(trace_scope_, __LINE__) __attribute__((cleanup(trace_span_end))) = trace_span_begin(name)
+
+// Same, with a detail string that must stay valid until the end of the block
+#define TRACE_SCOPE_ARG(name, arg)                                                                                     \
+    trace_span_t TRACE_CONCAT(trace_scope_, __LINE__) __attribute__((cleanup(trace_span_end))) =                      \
+        trace_span_begin_arg(name, arg)
+
+#else
+
+#define TRACE_SPAN_BEGIN(span, name) ((void)0)
+#define TRACE_SPAN_END(span)         ((void)0)
+#define TRACE_SCOPE(name)            ((void)0)
+#define TRACE_SCOPE_ARG(name, arg)   ((void)0)
+
+#endif // CONFIG_TRACE_ENABLE
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TRACE_H
@@ -0,0 +1,222 @@
+#include "trace.h"
+
+#if CONFIG_TRACE_ENABLE
+
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "radio_wazoo_config.h"
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+_Static_assert(configNUM_THREAD_LOCAL_STORAGE_POINTERS > TRACE_TLS_INDEX,
+               "raise CONFIG_FREERTOS_THREAD_LOCAL_STORAGE_POINTERS above TRACE_TLS_INDEX");
+
+typedef struct {
+    const char *name;
+    int64_t start_us;
+    uint32_t dur_us;
+    uint32_t arg; // argument sequence number + 1, 0 if none
+} trace_record_t;
+
+typedef struct {
+    atomic_bool claimed;     // owned by a live task
+    atomic_uint generation;  // odd while a new owner sets up the ring, bumped on every claim
+    char task_name[16];
+    atomic_uint base;        // head when the current owner claimed the ring, older records are not its
+    atomic_uint head;        // records written; only the owner advances it
+    trace_record_t records[TRACE_RING_SIZE];
+    atomic_uint arg_head;    // arguments written; only the owner advances it
+    char args[TRACE_ARG_RING_SIZE][TRACE_ARG_SIZE];
+} trace_ring_t;
+
+static trace_ring_t rings[TRACE_MAX_TASKS];
+static atomic_uint dropped;
+
+#if CONFIG_FREERTOS_TLSP_DELETION_CALLBACKS
+// Runs when the owner is deleted; its spans stay exportable until another task claims the ring
+static void release_ring(int index, void *ring) {
+    atomic_store_explicit(&((trace_ring_t *)ring)->claimed, false, memory_order_release);
+}
+#endif
+
+static trace_ring_t *ring_for_current_task(void) {
+    trace_ring_t *ring = pvTaskGetThreadLocalStoragePointer(NULL, TRACE_TLS_INDEX);
+    if (ring != NULL) {
+        return ring;
+    }
+
+    for (size_t i = 0; i < TRACE_MAX_TASKS; i++) {
+        bool expected = false;
+        if (!atomic_compare_exchange_strong_explicit(&rings[i].claimed, &expected, true, memory_order_acq_rel,
+                                                     memory_order_relaxed)) {
+            continue;
+        }
+
+        ring = &rings[i];
+        atomic_fetch_add_explicit(&ring->generation, 1, memory_order_acq_rel);
+        snprintf(ring->task_name, sizeof(ring->task_name), "%s", pcTaskGetName(NULL));
+        atomic_store_explicit(&ring->base, atomic_load_explicit(&ring->head, memory_order_relaxed),
+                              memory_order_relaxed);
+        atomic_fetch_add_explicit(&ring->generation, 1, memory_order_release);
+
+#if CONFIG_FREERTOS_TLSP_DELETION_CALLBACKS
+        vTaskSetThreadLocalStoragePointerAndDelCallback(NULL, TRACE_TLS_INDEX, ring, release_ring);
+#else
+        vTaskSetThreadLocalStoragePointer(NULL, TRACE_TLS_INDEX, ring);
+#endif
+        return ring;
+    }
+    return NULL;
+}
+
+trace_span_t trace_span_begin(const char *name) {
+    return (trace_span_t){.name = name, .arg = NULL, .start_us = esp_timer_get_time()};
+}
+
+trace_span_t trace_span_begin_arg(const char *name, const char *arg) {
+    return (trace_span_t){.name = name, .arg = arg, .start_us = esp_timer_get_time()};
+}
+
+void trace_span_end(trace_span_t *span) {
+    int64_t end_us = esp_timer_get_time();
+
+    trace_ring_t *ring = ring_for_current_task();
+    if (ring == NULL) {
+        atomic_fetch_add_explicit(&dropped, 1, memory_order_relaxed);
+        return;
+    }
+
+    uint32_t arg = 0;
+    if (span->arg != NULL) {
+        unsigned seq = atomic_load_explicit(&ring->arg_head, memory_order_relaxed);
+        snprintf(ring->args[seq % TRACE_ARG_RING_SIZE], TRACE_ARG_SIZE, "%s", span->arg);
+        atomic_store_explicit(&ring->arg_head, seq + 1, memory_order_release);
+        arg = seq + 1;
+    }
+
+    unsigned head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    trace_record_t *record = &ring->records[head % TRACE_RING_SIZE];
+    record->name = span->name;
+    record->start_us = span->start_us;
+    record->dur_us = (uint32_t)(end_us - span->start_us);
+    record->arg = arg;
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+}
+
+typedef struct {
+    trace_write_fn write;
+    void *ctx;
+    esp_err_t error;
+    size_t len;
+    char buf[512];
+} exporter_t;
+
+static void flush(exporter_t *out) {
+    if (out->len > 0 && out->error == ESP_OK) {
+        out->error = out->write(out->ctx, out->buf, out->len);
+    }
+    out->len = 0;
+}
+
+static void emit(exporter_t *out, const char *fmt, ...) {
+    char piece[256];
+    va_list args;
+    va_start(args, fmt);
+    int n = vsnprintf(piece, sizeof(piece), fmt, args);
+    va_end(args);
+    if (n < 0 || (size_t)n >= sizeof(piece)) {
+        return;
+    }
+
+    if (out->len + n > sizeof(out->buf)) {
+        flush(out);
+    }
+    memcpy(out->buf + out->len, piece, n);
+    out->len += n;
+}
+
+// Copies an argument the owner may overwrite meanwhile; false if it already has
+static bool read_arg(trace_ring_t *ring, uint32_t arg, char *dst) {
+    unsigned seq = arg - 1;
+    memcpy(dst, ring->args[seq % TRACE_ARG_RING_SIZE], TRACE_ARG_SIZE);
+    dst[TRACE_ARG_SIZE - 1] = '\0';
+    atomic_thread_fence(memory_order_acquire);
+    if (atomic_load_explicit(&ring->arg_head, memory_order_relaxed) - seq >= TRACE_ARG_RING_SIZE) {
+        return false;
+    }
+
+    // Arguments come from requests; keep the JSON valid without a full escaper
+    for (char *c = dst; *c != '\0'; c++) {
+        if (*c == '"' || *c == '\\' || (unsigned char)*c < 0x20) {
+            *c = '?';
+        }
+    }
+    return true;
+}
+
+esp_err_t trace_export(trace_write_fn write, void *ctx) {
+    exporter_t out = {.write = write, .ctx = ctx, .error = ESP_OK};
+    const char *separator = "";
+
+    emit(&out, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+
+    for (size_t i = 0; i < TRACE_MAX_TASKS && out.error == ESP_OK; i++) {
+        trace_ring_t *ring = &rings[i];
+
+        // Seqlock-style read: the ring may be reclaimed by a new task while we copy it
+        unsigned generation = atomic_load_explicit(&ring->generation, memory_order_acquire);
+        if (generation == 0 || (generation & 1) != 0) {
+            continue;
+        }
+        char task_name[sizeof(ring->task_name)];
+        memcpy(task_name, ring->task_name, sizeof(task_name));
+        task_name[sizeof(task_name) - 1] = '\0';
+        unsigned base = atomic_load_explicit(&ring->base, memory_order_relaxed);
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&ring->generation, memory_order_relaxed) != generation) {
+            continue;
+        }
+
+        // One track per owner, so a reused ring does not merge two tasks
+        unsigned tid = (unsigned)(generation / 2) * TRACE_MAX_TASKS + (unsigned)i + 1;
+        emit(&out, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}", separator,
+             tid, task_name);
+        separator = ",";
+
+        unsigned head = atomic_load_explicit(&ring->head, memory_order_acquire);
+        unsigned first = head - base > TRACE_RING_SIZE ? head - TRACE_RING_SIZE : base;
+
+        for (unsigned n = first; n != head && out.error == ESP_OK; n++) {
+            trace_record_t record = ring->records[n % TRACE_RING_SIZE];
+
+            // The owner keeps recording while we read; skip slots it may have reused meanwhile
+            atomic_thread_fence(memory_order_acquire);
+            if (atomic_load_explicit(&ring->head, memory_order_relaxed) - n >= TRACE_RING_SIZE ||
+                atomic_load_explicit(&ring->generation, memory_order_relaxed) != generation) {
+                continue;
+            }
+
+            char arg[TRACE_ARG_SIZE];
+            if (record.arg != 0 && read_arg(ring, record.arg, arg)) {
+                emit(&out,
+                     ",{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%lld,\"dur\":%lu,"
+                     "\"args\":{\"detail\":\"%s\"}}",
+                     record.name, tid, (long long)record.start_us, (unsigned long)record.dur_us, arg);
+            } else {
+                emit(&out, ",{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%lld,\"dur\":%lu}", record.name,
+                     tid, (long long)record.start_us, (unsigned long)record.dur_us);
+            }
+        }
+    }
+
+    emit(&out, "],\"otherData\":{\"dropped\":%u}}", atomic_load_explicit(&dropped, memory_order_relaxed));
+    flush(&out);
+
+    return out.error;
+}
+
+#endif // CONFIG_TRACE_ENABLE
@@ -0,0 +1,67 @@
+#include "esp_log.h"
+#include "gzip_stream.h"
+#include "sdkconfig.h"
+#include "webserver.h"
+#include <stdio.h>
+
+#if CONFIG_IDF_TARGET_LINUX
+#include <time.h>
+#define BENCH_UNIT "ns"
+static inline uint32_t bench_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)(ts.tv_sec * 1000000000ull + ts.tv_nsec);
+}
+#else
+#include "esp_cpu.h"
+#define BENCH_UNIT "cycles"
+static inline uint32_t bench_now(void) {
+    return esp_cpu_get_cycle_count();
+}
+#endif
+
+static const char *const TAG = "GZIP_BENCH";
+
+#define BENCH_ITERATIONS 16
+
+static char bench_json[4096];
+static gzip_stream_t bench_gz;
+
+static esp_err_t discard(void *ctx, const uint8_t *data, size_t len) {
+    return ESP_OK;
+}
+
+// Shaped like the /api/memory report: repeated keys, varying numbers
+static size_t build_payload(size_t target) {
+    size_t len = (size_t)snprintf(bench_json, sizeof(bench_json), "{\"history\":[");
+    for (unsigned i = 0; len + 96 < target && len + 96 < sizeof(bench_json); i++) {
+        len += (size_t)snprintf(bench_json + len, sizeof(bench_json) - len,
+                                "%s{\"uptime_s\":%u,\"free\":%u,\"largest\":%u,\"fragmentation\":%u}", i ? "," : "",
+                                i * 5, 81234 - (i * 37) % 900, 65536 - (i * 211) % 4096, (i * 7) % 30);
+    }
+    len += (size_t)snprintf(bench_json + len, sizeof(bench_json) - len, "]}");
+    return len;
+}
+
+static void bench_size(size_t target) {
+    size_t len = build_payload(target);
+
+    uint32_t start = bench_now();
+    for (int i = 0; i < BENCH_ITERATIONS; i++) {
+        gzip_stream_init(&bench_gz, discard, NULL);
+        gzip_stream_write(&bench_gz, bench_json, len);
+        gzip_stream_finish(&bench_gz);
+    }
+    uint32_t elapsed = (bench_now() - start) / BENCH_ITERATIONS;
+
+    uint32_t saved = len > bench_gz.total_out ? (uint32_t)(len - bench_gz.total_out) : 0;
+    ESP_LOGI(TAG, "%u -> %lu bytes (%lu%%): %lu %s, %lu %s per byte saved", (unsigned)len,
+             (unsigned long)bench_gz.total_out, (unsigned long)(bench_gz.total_out * 100 / len), (unsigned long)elapsed,
+             BENCH_UNIT, (unsigned long)(saved > 0 ? elapsed / saved : 0), BENCH_UNIT);
+}
+
+void webserver_gzip_benchmark(void) {
+    bench_size(256);
+    bench_size(1024);
+    bench_size(4000);
+}
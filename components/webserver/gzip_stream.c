@@ -0,0 +1,220 @@
+#include "gzip_stream.h"
+#include <stdbool.h>
+#include <string.h>
+
+#define MIN_MATCH 3
+#define MAX_MATCH 258
+#define HASH_SIZE (1 << GZIP_HASH_BITS)
+
+_Static_assert(GZIP_WINDOW_SIZE > MAX_MATCH, "window must be larger than the lookahead");
+_Static_assert(GZIP_WINDOW_SIZE <= 32768, "deflate distances are limited to 32K");
+
+// RFC 1951 3.2.5: length codes 257..285 and distance codes 0..29
+static const uint16_t length_base[29] = {3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+                                         31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+static const uint8_t length_extra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+                                         2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+static const uint16_t dist_base[30] = {1,   2,   3,   4,   5,   7,    9,    13,   17,   25,   33,   49,   65,    97,    129,
+                                       193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+static const uint8_t dist_extra[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6,
+                                       6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+// CRC-32 (gzip polynomial), a nibble at a time to keep the table at 64 bytes
+static const uint32_t crc_table[16] = {0x00000000, 0x1db71064, 0x3b6e20c8, 0x26d930ac, 0x76dc4190, 0x6b6b51f4,
+                                       0x4db26158, 0x5005713c, 0xedb88320, 0xf00f9344, 0xd6d6a3e8, 0xcb61b38c,
+                                       0x9b64c2b0, 0x86d3d2d4, 0xa00ae278, 0xbdbdf21c};
+
+static uint32_t crc32_update(uint32_t crc, const uint8_t *data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        crc ^= data[i];
+        crc = (crc >> 4) ^ crc_table[crc & 0x0F];
+        crc = (crc >> 4) ^ crc_table[crc & 0x0F];
+    }
+    return crc;
+}
+
+static void flush_out(gzip_stream_t *gz) {
+    if (gz->out_len > 0 && gz->error == ESP_OK) {
+        gz->error = gz->write(gz->ctx, gz->out, gz->out_len);
+    }
+    gz->total_out += gz->out_len;
+    gz->out_len = 0;
+}
+
+static void put_byte(gzip_stream_t *gz, uint8_t byte) {
+    gz->out[gz->out_len++] = byte;
+    if (gz->out_len == sizeof(gz->out)) {
+        flush_out(gz);
+    }
+}
+
+// Deflate packs bits LSB first
+static void put_bits(gzip_stream_t *gz, uint32_t value, unsigned count) {
+    gz->bit_buf |= value << gz->bit_count;
+    gz->bit_count += count;
+    while (gz->bit_count >= 8) {
+        put_byte(gz, (uint8_t)gz->bit_buf);
+        gz->bit_buf >>= 8;
+        gz->bit_count -= 8;
+    }
+}
+
+// ...but Huffman codes MSB first
+static void put_code(gzip_stream_t *gz, uint32_t code, unsigned length) {
+    uint32_t reversed = 0;
+    for (unsigned i = 0; i < length; i++) {
+        reversed = (reversed << 1) | ((code >> i) & 1);
+    }
+    put_bits(gz, reversed, length);
+}
+
+// Fixed literal/length code, RFC 1951 3.2.6
+static void put_symbol(gzip_stream_t *gz, unsigned symbol) {
+    if (symbol < 144) {
+        put_code(gz, 0x30 + symbol, 8);
+    } else if (symbol < 256) {
+        put_code(gz, 0x190 + symbol - 144, 9);
+    } else if (symbol < 280) {
+        put_code(gz, symbol - 256, 7);
+    } else {
+        put_code(gz, 0xC0 + symbol - 280, 8);
+    }
+}
+
+static void put_match(gzip_stream_t *gz, unsigned length, unsigned distance) {
+    unsigned code = 28;
+    while (length_base[code] > length) {
+        code--;
+    }
+    put_symbol(gz, 257 + code);
+    put_bits(gz, length - length_base[code], length_extra[code]);
+
+    code = 29;
+    while (dist_base[code] > distance) {
+        code--;
+    }
+    put_code(gz, code, 5);
+    put_bits(gz, distance - dist_base[code], dist_extra[code]);
+}
+
+static inline uint32_t hash3(const uint8_t *p) {
+    return (((uint32_t)p[0] << 16 | (uint32_t)p[1] << 8 | p[2]) * 2654435761u) >> (32 - GZIP_HASH_BITS);
+}
+
+// Encode buffered input, keeping MAX_MATCH bytes of lookahead unless flushing
+static void encode(gzip_stream_t *gz, bool flush) {
+    size_t limit = flush ? gz->end : (gz->end > MAX_MATCH ? gz->end - MAX_MATCH : 0);
+
+    while (gz->pos < limit) {
+        size_t pos = gz->pos;
+        size_t avail = gz->end - pos;
+        size_t best = 0;
+        size_t distance = 0;
+
+        if (avail >= MIN_MATCH) {
+            uint32_t h = hash3(&gz->buf[pos]);
+            size_t candidate = gz->head[h];
+            gz->head[h] = (uint16_t)(pos + 1);
+
+            if (candidate != 0 && pos - (candidate - 1) <= GZIP_WINDOW_SIZE) {
+                const uint8_t *a = &gz->buf[candidate - 1];
+                const uint8_t *b = &gz->buf[pos];
+                size_t max = avail < MAX_MATCH ? avail : MAX_MATCH;
+                while (best < max && a[best] == b[best]) {
+                    best++;
+                }
+                distance = pos - (candidate - 1);
+            }
+        }
+
+        if (best >= MIN_MATCH) {
+            put_match(gz, best, distance);
+            // Index the covered positions so later data can refer back into them
+            for (size_t i = 1; i < best && pos + i + MIN_MATCH <= gz->end; i++) {
+                gz->head[hash3(&gz->buf[pos + i])] = (uint16_t)(pos + i + 1);
+            }
+            gz->pos += best;
+        } else {
+            put_symbol(gz, gz->buf[pos]);
+            gz->pos++;
+        }
+    }
+}
+
+// Drop the oldest window's worth of input once the buffer is full
+static void slide(gzip_stream_t *gz) {
+    memmove(gz->buf, gz->buf + GZIP_WINDOW_SIZE, gz->end - GZIP_WINDOW_SIZE);
+    gz->pos -= GZIP_WINDOW_SIZE;
+    gz->end -= GZIP_WINDOW_SIZE;
+    for (size_t i = 0; i < HASH_SIZE; i++) {
+        gz->head[i] = gz->head[i] > GZIP_WINDOW_SIZE ? gz->head[i] - GZIP_WINDOW_SIZE : 0;
+    }
+}
+
+void gzip_stream_init(gzip_stream_t *gz, gzip_write_fn write, void *ctx) {
+    gz->write = write;
+    gz->ctx = ctx;
+    gz->error = ESP_OK;
+    memset(gz->head, 0, sizeof(gz->head));
+    gz->pos = 0;
+    gz->end = 0;
+    gz->bit_buf = 0;
+    gz->bit_count = 0;
+    gz->out_len = 0;
+    gz->crc = 0xFFFFFFFF;
+    gz->total_in = 0;
+    gz->total_out = 0;
+
+    // Header: magic, deflate, no flags, no mtime, unknown OS
+    static const uint8_t header[10] = {0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff};
+    for (size_t i = 0; i < sizeof(header); i++) {
+        put_byte(gz, header[i]);
+    }
+
+    // A single final block with fixed codes: it has no size limit, so the stream never needs a second one
+    put_bits(gz, 1, 1); // BFINAL
+    put_bits(gz, 1, 2); // BTYPE = fixed Huffman
+}
+
+esp_err_t gzip_stream_write(gzip_stream_t *gz, const void *data, size_t len) {
+    const uint8_t *in = data;
+
+    while (len > 0 && gz->error == ESP_OK) {
+        size_t n = sizeof(gz->buf) - gz->end;
+        if (n > len) {
+            n = len;
+        }
+        memcpy(gz->buf + gz->end, in, n);
+        gz->crc = crc32_update(gz->crc, in, n);
+        gz->total_in += n;
+        gz->end += n;
+        in += n;
+        len -= n;
+
+        if (gz->end == sizeof(gz->buf)) {
+            encode(gz, false);
+            slide(gz);
+        }
+    }
+
+    return gz->error;
+}
+
+esp_err_t gzip_stream_finish(gzip_stream_t *gz) {
+    encode(gz, true);
+    put_symbol(gz, 256); // end of block
+    if (gz->bit_count > 0) {
+        put_bits(gz, 0, 8 - gz->bit_count);
+    }
+
+    uint32_t crc = ~gz->crc;
+    for (int i = 0; i < 4; i++) {
+        put_byte(gz, (uint8_t)(crc >> (8 * i)));
+    }
+    for (int i = 0; i < 4; i++) {
+        put_byte(gz, (uint8_t)(gz->total_in >> (8 * i)));
+    }
+    flush_out(gz);
+
+    return gz->error;
+}
@@ -0,0 +1,77 @@
+#ifndef GZIP_STREAM_H
+#define GZIP_STREAM_H
+
+#include "esp_err.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define GZIP_WINDOW_SIZE 1024 // LZ77 window, bounds match distance and RAM
+#define GZIP_HASH_BITS   9
+#define GZIP_OUT_SIZE    512  // compressed bytes buffered before each write callback
+
+/**
+ * Sink for compressed output, e.g. a chunked HTTP response
+ */
+typedef esp_err_t (*gzip_write_fn)(void *ctx, const uint8_t *data, size_t len);
+
+/**
+ * Streaming gzip encoder: one fixed-Huffman deflate block with greedy LZ77
+ * matching. All state lives in this struct (about 3.5KB), nothing is
+ * allocated.
+ */
+typedef struct {
+    gzip_write_fn write;
+    void *ctx;
+    esp_err_t error;
+
+    uint8_t buf[GZIP_WINDOW_SIZE * 2]; // window followed by lookahead
+    uint16_t head[1 << GZIP_HASH_BITS]; // last buf position + 1 per hash, 0 if none
+    size_t pos;                         // next byte to encode
+    size_t end;                         // bytes valid in buf
+
+    uint32_t bit_buf;
+    unsigned bit_count;
+    uint8_t out[GZIP_OUT_SIZE];
+    size_t out_len;
+
+    uint32_t crc;
+    uint32_t total_in;
+    uint32_t total_out;
+} gzip_stream_t;
+
+/**
+ * @brief Start a gzip stream and emit its header
+ *
+ * @param gz Encoder state
+ * @param write Output callback
+ * @param ctx Callback context
+ */
+void gzip_stream_init(gzip_stream_t *gz, gzip_write_fn write, void *ctx);
+
+/**
+ * @brief Compress more input
+ *
+ * @param gz Encoder state
+ * @param data Input bytes
+ * @param len Input length
+ * @return esp_err_t ESP_OK, or the first error returned by the write callback
+ */
+esp_err_t gzip_stream_write(gzip_stream_t *gz, const void *data, size_t len);
+
+/**
+ * @brief Encode remaining input, end the block and emit the gzip trailer
+ *
+ * @param gz Encoder state
+ * @return esp_err_t ESP_OK, or the first error returned by the write callback
+ */
+esp_err_t gzip_stream_finish(gzip_stream_t *gz);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // GZIP_STREAM_H
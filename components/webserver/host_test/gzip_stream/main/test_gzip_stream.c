@@ -0,0 +1,182 @@
+#include "gzip_stream.h"
+#include "unity.h"
+#include "webserver.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+
+/*
+ * Every input is compressed with gzip_stream and decompressed with zlib's
+ * inflate, which rejects a bad header, code, distance, CRC or length.
+ * Inputs longer than two windows go through slide() several times.
+ */
+#define INPUT_MAX  (GZIP_WINDOW_SIZE * 10)
+#define OUTPUT_MAX (INPUT_MAX * 2 + 64) // fixed codes never take more than 9 bits per byte
+
+static const size_t write_sizes[] = {1, 7, 100, GZIP_WINDOW_SIZE, GZIP_WINDOW_SIZE * 2 + 1, INPUT_MAX};
+#define WRITE_SIZES (sizeof(write_sizes) / sizeof(write_sizes[0]))
+
+static uint8_t input[INPUT_MAX];
+static uint8_t compressed[OUTPUT_MAX];
+static size_t compressed_len;
+static uint8_t inflated[INPUT_MAX + 1];
+static gzip_stream_t gz;
+static uint32_t rng;
+
+void setUp(void) {
+    compressed_len = 0;
+    rng = 1;
+}
+
+void tearDown(void) {}
+
+static uint8_t next_random(void) {
+    rng = rng * 1103515245u + 12345u;
+    return (uint8_t)(rng >> 16);
+}
+
+static esp_err_t collect(void *ctx, const uint8_t *data, size_t len) {
+    TEST_ASSERT_LESS_OR_EQUAL(GZIP_OUT_SIZE, len);
+    TEST_ASSERT_LESS_OR_EQUAL(sizeof(compressed) - compressed_len, len);
+    memcpy(compressed + compressed_len, data, len);
+    compressed_len += len;
+    return ESP_OK;
+}
+
+static void gzip_input(const uint8_t *data, size_t len, size_t write_size) {
+    compressed_len = 0;
+    gzip_stream_init(&gz, collect, NULL);
+    for (size_t pos = 0; pos < len; pos += write_size) {
+        size_t n = len - pos < write_size ? len - pos : write_size;
+        TEST_ASSERT_EQUAL(ESP_OK, gzip_stream_write(&gz, data + pos, n));
+    }
+    TEST_ASSERT_EQUAL(ESP_OK, gzip_stream_finish(&gz));
+    TEST_ASSERT_EQUAL(compressed_len, gz.total_out);
+    TEST_ASSERT_EQUAL(len, gz.total_in);
+}
+
+// Decompresses with zlib, gzip wrapper only (windowBits 16 + 15)
+static size_t inflate_output(void) {
+    z_stream zs = {0};
+    TEST_ASSERT_EQUAL(Z_OK, inflateInit2(&zs, 16 + MAX_WBITS));
+    zs.next_in = compressed;
+    zs.avail_in = (uInt)compressed_len;
+    zs.next_out = inflated;
+    zs.avail_out = sizeof(inflated);
+    int ret = inflate(&zs, Z_FINISH);
+    size_t len = zs.total_out;
+    size_t unused = zs.avail_in;
+    inflateEnd(&zs);
+
+    TEST_ASSERT_EQUAL_MESSAGE(Z_STREAM_END, ret, "inflate rejected the stream");
+    TEST_ASSERT_EQUAL_MESSAGE(0, unused, "bytes after the gzip trailer");
+    return len;
+}
+
+static void assert_round_trip(const uint8_t *data, size_t len) {
+    for (size_t i = 0; i < WRITE_SIZES; i++) {
+        gzip_input(data, len, write_sizes[i]);
+        size_t out = inflate_output();
+        TEST_ASSERT_EQUAL(len, out);
+        if (len > 0) {
+            TEST_ASSERT_EQUAL_MEMORY(data, inflated, len);
+        }
+    }
+}
+
+static void test_empty(void) {
+    assert_round_trip(input, 0);
+}
+
+static void test_short(void) {
+    memcpy(input, "ab", 2);
+    assert_round_trip(input, 2); // shorter than a match
+    memcpy(input, "aaaa", 4);
+    assert_round_trip(input, 4); // a match overlapping itself
+}
+
+// Incompressible: all literals, including the 9-bit codes for bytes 144..255
+static void test_random(void) {
+    for (size_t i = 0; i < INPUT_MAX; i++) {
+        input[i] = next_random();
+    }
+    assert_round_trip(input, INPUT_MAX);
+    assert_round_trip(input, GZIP_WINDOW_SIZE * 2 + 3);
+}
+
+// Runs longer than MAX_MATCH, distance 1
+static void test_repetitive(void) {
+    memset(input, 'x', INPUT_MAX);
+    assert_round_trip(input, INPUT_MAX);
+
+    gzip_input(input, INPUT_MAX, INPUT_MAX);
+    TEST_ASSERT_LESS_THAN(INPUT_MAX / 50, compressed_len);
+}
+
+// A random block repeated at a distance near the window size, so matches reach back across slide()
+static void test_matches_across_slide(void) {
+    size_t period = GZIP_WINDOW_SIZE - 24;
+    for (size_t i = 0; i < period; i++) {
+        input[i] = next_random();
+    }
+    for (size_t i = period; i < INPUT_MAX; i++) {
+        input[i] = input[i - period];
+    }
+    assert_round_trip(input, INPUT_MAX);
+
+    // All literals would take more than INPUT_MAX; hash collisions cost some matches, most remain
+    gzip_input(input, INPUT_MAX, 100);
+    TEST_ASSERT_LESS_THAN(INPUT_MAX / 2, compressed_len);
+}
+
+// Shaped like the API reports: repeated keys, varying numbers
+static void test_json(void) {
+    size_t len = 0;
+    len += (size_t)snprintf((char *)input, sizeof(input), "{\"history\":[");
+    for (unsigned i = 0; len + 96 < sizeof(input); i++) {
+        len += (size_t)snprintf((char *)input + len, sizeof(input) - len,
+                                "%s{\"uptime\":%u,\"free\":%u,\"largest\":%u,\"fragmentation\":%u}", i ? "," : "", i * 5,
+                                81234 - (i * 37) % 900, 65536 - (i * 211) % 4096, (i * 7) % 30);
+    }
+    len += (size_t)snprintf((char *)input + len, sizeof(input) - len, "]}");
+    TEST_ASSERT_GREATER_THAN(GZIP_WINDOW_SIZE * 2, len);
+
+    assert_round_trip(input, len);
+    assert_round_trip(input, 2500);
+}
+
+static esp_err_t fail_second(void *ctx, const uint8_t *data, size_t len) {
+    int *calls = ctx;
+    return ++*calls >= 2 ? ESP_FAIL : ESP_OK;
+}
+
+// A failed write, e.g. a closed socket, is reported and stops further output
+static void test_write_error_propagates(void) {
+    int calls = 0;
+    for (size_t i = 0; i < INPUT_MAX; i++) {
+        input[i] = next_random();
+    }
+    gzip_stream_init(&gz, fail_second, &calls);
+    esp_err_t ret = gzip_stream_write(&gz, input, INPUT_MAX);
+    TEST_ASSERT_EQUAL(ESP_FAIL, ret);
+    TEST_ASSERT_EQUAL(ESP_FAIL, gzip_stream_finish(&gz));
+    TEST_ASSERT_EQUAL(2, calls);
+}
+
+static void test_benchmark(void) {
+    webserver_gzip_benchmark();
+}
+
+void app_main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_empty);
+    RUN_TEST(test_short);
+    RUN_TEST(test_random);
+    RUN_TEST(test_repetitive);
+    RUN_TEST(test_matches_across_slide);
+    RUN_TEST(test_json);
+    RUN_TEST(test_write_error_propagates);
+    RUN_TEST(test_benchmark);
+    exit(UNITY_END());
+}
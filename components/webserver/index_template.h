@@ -0,0 +1,17 @@
+// Generated by npx gulp templates from src/www/index.html - do not edit
+#ifndef INDEX_TEMPLATE_H
+#define INDEX_TEMPLATE_H
+
+#include "template.h"
+
+static const template_segment_t index_template[] = {
+    TEMPLATE_TEXT_SEGMENT("<!DOCTYPE html>\n<html data-theme=\"light\">\n<head>\n    <meta charset=\"utf-8\">\n    <meta name=\"viewport\" content=\"initial-scale=1, maximum-scale=1, user-scalable=no, width=device-width\">\n    <title></title>\n    <link rel=\"icon\" type=\"image/svg+xml\" href=\"/assets/images/favicon.svg\">\n    <link href=\"/assets/css/main.min.css\" rel=\"stylesheet\">\n</head>\n<body x-data=\"{theme: $persist('system')}\">\n\n<div class=\"container\">\n    <header>\n        <section class=\"service\">"),
+    TEMPLATE_SLOT_SEGMENT(TEMPLATE_SLOT_SSID),
+    TEMPLATE_TEXT_SEGMENT("</section>\n        <section class=\"logotype\"></section>\n    </header>\n    <main>\n        <article class=\"nowplaying\">\n            <hgroup>\n                <h2>"),
+    TEMPLATE_SLOT_SEGMENT(TEMPLATE_SLOT_TITLE),
+    TEMPLATE_TEXT_SEGMENT("</h2>\n                <p>"),
+    TEMPLATE_SLOT_SEGMENT(TEMPLATE_SLOT_STATION),
+    TEMPLATE_TEXT_SEGMENT("</p>\n            </hgroup>\n        </article>\n    </main>\n    <footer>\n    </footer>\n</div>\n\n<script src=\"/assets/js/main.min.js\"></script>\n</body>\n</html>\n"),
+};
+
+#endif // INDEX_TEMPLATE_H
@@ -0,0 +1,101 @@
+#include "template.h"
+#include "access_point.h"
+#include "esp_log.h"
+#include "nowplaying.h"
+#include <stdio.h>
+#include <string.h>
+
+static const char *const TAG = "TEMPLATE";
+
+#define ESCAPED_MAX (NOWPLAYING_TEXT_MAX * 2)
+
+typedef struct {
+    char ssid[33];
+    char station[NOWPLAYING_TEXT_MAX];
+    char title[NOWPLAYING_TEXT_MAX];
+} template_values_t;
+
+// Escape into out, truncating at an entity boundary when out is full
+static size_t html_escape(char *out, size_t out_size, const char *in) {
+    size_t len = 0;
+
+    for (; *in != '\0'; in++) {
+        const char *entity = NULL;
+        switch (*in) {
+        case '&':
+            entity = "&amp;";
+            break;
+        case '<':
+            entity = "&lt;";
+            break;
+        case '>':
+            entity = "&gt;";
+            break;
+        case '"':
+            entity = "&quot;";
+            break;
+        case '\'':
+            entity = "&#39;";
+            break;
+        default:
+            break;
+        }
+
+        size_t n = entity != NULL ? strlen(entity) : 1;
+        if (len + n >= out_size) {
+            break;
+        }
+        if (entity != NULL) {
+            memcpy(out + len, entity, n);
+        } else {
+            out[len] = *in;
+        }
+        len += n;
+    }
+
+    out[len] = '\0';
+    return len;
+}
+
+static const char *slot_value(template_kind_t kind, const template_values_t *values) {
+    switch (kind) {
+    case TEMPLATE_SLOT_SSID:
+        return values->ssid;
+    case TEMPLATE_SLOT_STATION:
+        return values->station;
+    case TEMPLATE_SLOT_TITLE:
+        return values->title;
+    default:
+        return "";
+    }
+}
+
+esp_err_t template_render(httpd_req_t *req, const template_segment_t *segments, size_t count) {
+    template_values_t values;
+    char escaped[ESCAPED_MAX];
+
+    // One consistent snapshot for the whole page
+    access_point_get_ssid(values.ssid, sizeof(values.ssid));
+    nowplaying_get_current(values.station, sizeof(values.station), values.title, sizeof(values.title));
+
+    httpd_resp_set_type(req, "text/html");
+
+    for (size_t i = 0; i < count; i++) {
+        const template_segment_t *segment = &segments[i];
+        esp_err_t ret;
+
+        if (segment->kind == TEMPLATE_TEXT) {
+            ret = httpd_resp_send_chunk(req, segment->text, segment->len);
+        } else {
+            size_t len = html_escape(escaped, sizeof(escaped), slot_value(segment->kind, &values));
+            ret = len > 0 ? httpd_resp_send_chunk(req, escaped, len) : ESP_OK;
+        }
+
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to send segment %u", (unsigned)i);
+            return ret;
+        }
+    }
+
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
@@ -0,0 +1,53 @@
+#ifndef TEMPLATE_H
+#define TEMPLATE_H
+
+#include "esp_err.h"
+#include "esp_http_server.h"
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Segment kinds: literal text or a named slot filled at request time.
+ * Slot names in templates map to TEMPLATE_SLOT_<NAME>, so a template using
+ * an unknown slot fails to compile.
+ */
+typedef enum {
+    TEMPLATE_TEXT = 0,
+    TEMPLATE_SLOT_SSID,
+    TEMPLATE_SLOT_STATION,
+    TEMPLATE_SLOT_TITLE,
+} template_kind_t;
+
+typedef struct {
+    template_kind_t kind;
+    const char *text; // TEMPLATE_TEXT only, lives in flash
+    size_t len;
+} template_segment_t;
+
+/** Literal segment with its length computed by the compiler */
+#define TEMPLATE_TEXT_SEGMENT(literal) {TEMPLATE_TEXT, literal, sizeof(literal) - 1}
+
+/** Slot segment */
+#define TEMPLATE_SLOT_SEGMENT(slot) {slot, NULL, 0}
+
+/**
+ * @brief Stream a template as a chunked response
+ *
+ * Literal segments are sent straight from flash; slot values are HTML-escaped
+ * into a small stack buffer. Nothing is assembled on the heap.
+ *
+ * @param req HTTP request
+ * @param segments Segment table
+ * @param count Number of segments
+ * @return esp_err_t ESP_OK on success
+ */
+esp_err_t template_render(httpd_req_t *req, const template_segment_t *segments, size_t count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TEMPLATE_H
@@ -1,15 +1,32 @@
 #include "webserver.h"
+#include "access_point.h"
 #include "esp_http_server.h"
 #include "esp_log.h"
 #include "esp_netif.h"
+#include "event_bus.h"
 #include "filesystem.h"
+#include "gzip_stream.h"
+#include "index_template.h"
+#include "memory_budget.h"
+#include "nowplaying.h"
+#include "power.h"
+#include "radio_wazoo_config.h"
+#include "sdkconfig.h"
+#include "trace.h"
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 #include <sys/stat.h>
 
 static const char *const TAG = "WEBSERVER";
 
 #define CHUNK_SIZE 1024
+#define FS_API_PREFIX "/api/fs"
+#define FS_PATH_MAX 256
+#define JSON_BUFFER_SIZE 2048
+#define MEMORY_JSON_BUFFER_SIZE 4096 // worst case is about 3.4 KB, see memory_budget_soak
+#define WEBSERVER_ALLOC_CAPS (MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT)
 
 static esp_err_t send_error_response(httpd_req_t *req, int status_code, const char *message) {
     char json_response[256];
@@ -19,6 +36,13 @@ static esp_err_t send_error_response(httpd_req_t *req, int status_code, const ch
     case 404:
         httpd_resp_set_status(req, "404 Not Found");
         break;
+    case 413:
+        httpd_resp_set_status(req, "413 Payload Too Large");
+        break;
+    case 503:
+        httpd_resp_set_status(req, "503 Service Unavailable");
+        httpd_resp_set_hdr(req, "Retry-After", "1");
+        break;
     case 500:
         httpd_resp_set_status(req, "500 Internal Server Error");
         break;
@@ -32,6 +56,72 @@ static esp_err_t send_error_response(httpd_req_t *req, int status_code, const ch
     return ESP_FAIL;
 }
 
+/**
+ * Refuse new work with 503 while internal RAM is low or fragmented, so WiFi
+ * and LittleFS keep the blocks they need. Returns true if the request was shed.
+ */
+static bool shed_load(httpd_req_t *req) {
+    if (!memory_budget_under_pressure()) {
+        return false;
+    }
+    send_error_response(req, 503, "Server busy");
+    return true;
+}
+
+// Handlers run one at a time in the httpd task, so one encoder is enough
+static gzip_stream_t gzip;
+
+// True if Accept-Encoding lists gzip without q=0
+static bool accepts_gzip(httpd_req_t *req) {
+    char accept[128];
+    if (httpd_req_get_hdr_value_str(req, "Accept-Encoding", accept, sizeof(accept)) != ESP_OK) {
+        return false;
+    }
+
+    char *saveptr;
+    for (char *token = strtok_r(accept, ",", &saveptr); token != NULL; token = strtok_r(NULL, ",", &saveptr)) {
+        while (*token == ' ') {
+            token++;
+        }
+        size_t name_len = strcspn(token, " ;");
+        if (name_len != 4 || strncasecmp(token, "gzip", 4) != 0) {
+            continue;
+        }
+        const char *q = strstr(token, "q=");
+        return q == NULL || strtof(q + 2, NULL) > 0;
+    }
+    return false;
+}
+
+static esp_err_t send_gzip_chunk(void *ctx, const uint8_t *data, size_t len) {
+    return httpd_resp_send_chunk(ctx, (const char *)data, len);
+}
+
+/**
+ * Send a rendered JSON body, gzip-compressed as chunks when it is large
+ * enough to be worth it and the client accepts it
+ */
+static esp_err_t send_json(httpd_req_t *req, const char *json, size_t len) {
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Vary", "Accept-Encoding");
+
+    if (len < WEBSERVER_GZIP_MIN_SIZE || !accepts_gzip(req)) {
+        return httpd_resp_send(req, json, len);
+    }
+
+    httpd_resp_set_hdr(req, "Content-Encoding", "gzip");
+    gzip_stream_init(&gzip, send_gzip_chunk, req);
+    gzip_stream_write(&gzip, json, len);
+    esp_err_t ret = gzip_stream_finish(&gzip);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to send compressed response");
+        return ret;
+    }
+
+    ESP_LOGD(TAG, "%s: gzip %u -> %lu bytes", req->uri, (unsigned)len, (unsigned long)gzip.total_out);
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
+
 static const char *get_content_type(const char *path) {
     const char *ext = strrchr(path, '.');
     if (ext == NULL)
@@ -58,7 +148,15 @@ static const char *get_content_type(const char *path) {
 }
 
 static esp_err_t serve_static_file(httpd_req_t *req, const char *filepath) {
+    TRACE_SCOPE("serve_static_file");
+
+    if (shed_load(req)) {
+        return ESP_FAIL;
+    }
+
+    TRACE_SPAN_BEGIN(open_span, "fopen");
     FILE *file = fopen(filepath, "r");
+    TRACE_SPAN_END(open_span);
     if (file == NULL) {
         ESP_LOGE(TAG, "Failed to open file: %s", filepath);
         return send_error_response(req, 404, "File not found");
@@ -67,18 +165,23 @@ static esp_err_t serve_static_file(httpd_req_t *req, const char *filepath) {
     const char *content_type = get_content_type(filepath);
     httpd_resp_set_type(req, content_type);
 
-    char *chunk = malloc(CHUNK_SIZE);
+    char *chunk = memory_budget_alloc(MEMORY_TAG_WEBSERVER, CHUNK_SIZE, WEBSERVER_ALLOC_CAPS);
     if (chunk == NULL) {
         ESP_LOGE(TAG, "Failed to allocate chunk buffer");
         fclose(file);
-        return send_error_response(req, 500, "Out of memory");
+        return send_error_response(req, 503, "Out of memory");
     }
 
     size_t read_bytes;
     do {
+        TRACE_SPAN_BEGIN(read_span, "fread");
         read_bytes = fread(chunk, 1, CHUNK_SIZE, file);
+        TRACE_SPAN_END(read_span);
         if (read_bytes > 0) {
-            if (httpd_resp_send_chunk(req, chunk, read_bytes) != ESP_OK) {
+            TRACE_SPAN_BEGIN(send_span, "httpd_resp_send_chunk");
+            esp_err_t sent = httpd_resp_send_chunk(req, chunk, read_bytes);
+            TRACE_SPAN_END(send_span);
+            if (sent != ESP_OK) {
                 ESP_LOGE(TAG, "Failed to send chunk");
                 break;
             }
@@ -87,14 +190,14 @@ static esp_err_t serve_static_file(httpd_req_t *req, const char *filepath) {
 
     httpd_resp_send_chunk(req, NULL, 0);
 
-    free(chunk);
+    memory_budget_free(chunk);
     fclose(file);
     return ESP_OK;
 }
 
 static esp_err_t root_handler(httpd_req_t *req) {
     ESP_LOGI(TAG, "GET / request received");
-    return serve_static_file(req, "/littlefs/www/index.html");
+    return template_render(req, index_template, sizeof(index_template) / sizeof(index_template[0]));
 }
 
 static esp_err_t static_handler(httpd_req_t *req) {
@@ -104,19 +207,376 @@ static esp_err_t static_handler(httpd_req_t *req) {
     return serve_static_file(req, filepath);
 }
 
+#if CONFIG_WEBSERVER_FS_API
+static int hex_value(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    c |= 0x20;
+    return c >= 'a' && c <= 'f' ? c - 'a' + 10 : -1;
+}
+
+/**
+ * Map "/api/fs/<path>" onto the LittleFS mount point, percent-decoding the
+ * path. Rejects empty paths, NUL bytes, parent directory references and
+ * anything that would not fit the buffer.
+ */
+static bool fs_api_resolve_path(httpd_req_t *req, char *filepath, size_t filepath_size) {
+    const char *rel = req->uri + strlen(FS_API_PREFIX);
+    size_t rel_len = strcspn(rel, "?#");
+
+    if (rel_len < 2 || rel[0] != '/' || rel[rel_len - 1] == '/') {
+        return false;
+    }
+
+    size_t len = strlen(LITTLEFS_BASE_PATH);
+    if (len >= filepath_size) {
+        return false;
+    }
+    memcpy(filepath, LITTLEFS_BASE_PATH, len);
+
+    for (size_t i = 0; i < rel_len; i++) {
+        char c = rel[i];
+        if (c == '%') {
+            int hi = i + 2 < rel_len ? hex_value(rel[i + 1]) : -1;
+            int lo = hi >= 0 ? hex_value(rel[i + 2]) : -1;
+            if (lo < 0 || (hi | lo) == 0) {
+                return false;
+            }
+            c = (char)(hi << 4 | lo);
+            i += 2;
+        }
+        if (len + 1 >= filepath_size) {
+            return false;
+        }
+        filepath[len++] = c;
+    }
+    filepath[len] = '\0';
+
+    // Checked after decoding so "%2e%2e" cannot slip through
+    return strstr(filepath, "..") == NULL;
+}
+
+static esp_err_t fs_get_handler(httpd_req_t *req) {
+    char filepath[FS_PATH_MAX];
+    if (!fs_api_resolve_path(req, filepath, sizeof(filepath))) {
+        return send_error_response(req, 400, "Invalid path");
+    }
+    ESP_LOGI(TAG, "FS download request: %s", filepath);
+    return serve_static_file(req, filepath);
+}
+
+static int recv_upload(void *ctx, char *buffer, size_t size) {
+    httpd_req_t *req = ctx;
+    int received;
+    do {
+        received = httpd_req_recv(req, buffer, size);
+    } while (received == HTTPD_SOCK_ERR_TIMEOUT);
+    return received;
+}
+
+static esp_err_t fs_put_handler(httpd_req_t *req) {
+    char filepath[FS_PATH_MAX];
+    if (!fs_api_resolve_path(req, filepath, sizeof(filepath))) {
+        return send_error_response(req, 400, "Invalid path");
+    }
+
+    if (shed_load(req)) {
+        return ESP_FAIL;
+    }
+
+    size_t total = 0, used = 0;
+    if (filesystem_get_info(&total, &used) == ESP_OK && req->content_len > total - used) {
+        return send_error_response(req, 413, "Not enough space");
+    }
+
+    char *chunk = memory_budget_alloc(MEMORY_TAG_WEBSERVER, CHUNK_SIZE, WEBSERVER_ALLOC_CAPS);
+    if (chunk == NULL) {
+        ESP_LOGE(TAG, "Failed to allocate chunk buffer");
+        return send_error_response(req, 503, "Out of memory");
+    }
+
+    // One open file for the whole body, renamed over the original only once it is complete
+    esp_err_t ret = filesystem_write_stream(filepath, req->content_len, chunk, CHUNK_SIZE, recv_upload, req);
+    memory_budget_free(chunk);
+
+    if (ret != ESP_OK) {
+        return send_error_response(req, 500, "Failed to store file");
+    }
+
+    ESP_LOGI(TAG, "FS upload stored: %s (%d bytes)", filepath, req->content_len);
+
+    char json_response[64];
+    snprintf(json_response, sizeof(json_response), "{\"status\":200,\"bytes\":%d}", req->content_len);
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_send(req, json_response, HTTPD_RESP_USE_STRLEN);
+}
+
+static esp_err_t fs_delete_handler(httpd_req_t *req) {
+    char filepath[FS_PATH_MAX];
+    if (!fs_api_resolve_path(req, filepath, sizeof(filepath))) {
+        return send_error_response(req, 400, "Invalid path");
+    }
+
+    esp_err_t ret = filesystem_delete_file(filepath);
+    if (ret == ESP_ERR_NOT_FOUND) {
+        return send_error_response(req, 404, "File not found");
+    }
+    if (ret != ESP_OK) {
+        return send_error_response(req, 500, "Failed to delete file");
+    }
+
+    ESP_LOGI(TAG, "FS delete: %s", filepath);
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_send(req, "{\"status\":200}", HTTPD_RESP_USE_STRLEN);
+}
+#endif // CONFIG_WEBSERVER_FS_API
+
+static esp_err_t nowplaying_handler(httpd_req_t *req) {
+    char etag[16];
+    char if_none_match[16];
+
+    // Polling clients revalidate with If-None-Match and get an empty 304 until the track changes.
+    // Weak, because the gzip and identity encodings share it
+    snprintf(etag, sizeof(etag), "W/\"%08lx\"", (unsigned long)nowplaying_version());
+    if (httpd_req_get_hdr_value_str(req, "If-None-Match", if_none_match, sizeof(if_none_match)) == ESP_OK &&
+        strcmp(if_none_match, etag) == 0) {
+        httpd_resp_set_status(req, "304 Not Modified");
+        httpd_resp_set_hdr(req, "ETag", etag);
+        return httpd_resp_send(req, NULL, 0);
+    }
+
+    if (shed_load(req)) {
+        return ESP_FAIL;
+    }
+
+    char *json = memory_budget_alloc(MEMORY_TAG_WEBSERVER, JSON_BUFFER_SIZE, WEBSERVER_ALLOC_CAPS);
+    if (json == NULL) {
+        ESP_LOGE(TAG, "Failed to allocate JSON buffer");
+        return send_error_response(req, 503, "Out of memory");
+    }
+
+    uint32_t version;
+    size_t len = nowplaying_to_json(json, JSON_BUFFER_SIZE, &version);
+    if (len == 0) {
+        memory_budget_free(json);
+        return send_error_response(req, 500, "Now playing too large");
+    }
+
+    snprintf(etag, sizeof(etag), "W/\"%08lx\"", (unsigned long)version);
+    httpd_resp_set_hdr(req, "ETag", etag);
+    httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
+    esp_err_t ret = send_json(req, json, len);
+
+    memory_budget_free(json);
+    return ret;
+}
+
+static esp_err_t memory_handler(httpd_req_t *req) {
+    // Not shed: this is what you look at when the device is under pressure
+    char *json = memory_budget_alloc(MEMORY_TAG_WEBSERVER, MEMORY_JSON_BUFFER_SIZE, WEBSERVER_ALLOC_CAPS);
+    if (json == NULL) {
+        return send_error_response(req, 503, "Out of memory");
+    }
+
+    size_t len = memory_budget_to_json(json, MEMORY_JSON_BUFFER_SIZE);
+    if (len == 0) {
+        memory_budget_free(json);
+        return send_error_response(req, 500, "Memory report too large");
+    }
+
+    httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+    esp_err_t ret = send_json(req, json, len);
+
+    memory_budget_free(json);
+    return ret;
+}
+
+static esp_err_t power_handler(httpd_req_t *req) {
+    char json[256];
+    size_t len = power_to_json(json, sizeof(json));
+    if (len == 0) {
+        return send_error_response(req, 500, "Power report too large");
+    }
+
+    httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+    return send_json(req, json, len);
+}
+
+static esp_err_t events_handler(httpd_req_t *req) {
+    char json[512];
+    size_t len = event_bus_to_json(json, sizeof(json));
+    if (len == 0) {
+        return send_error_response(req, 500, "Event report too large");
+    }
+
+    httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+    return send_json(req, json, len);
+}
+
+static esp_err_t network_handler(httpd_req_t *req) {
+    char json[512];
+    size_t len = access_point_network_to_json(json, sizeof(json));
+    if (len == 0) {
+        return send_error_response(req, 500, "Network report too large");
+    }
+
+    httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+    return send_json(req, json, len);
+}
+
+static esp_err_t storage_handler(httpd_req_t *req) {
+    char *json = memory_budget_alloc(MEMORY_TAG_WEBSERVER, JSON_BUFFER_SIZE, WEBSERVER_ALLOC_CAPS);
+    if (json == NULL) {
+        return send_error_response(req, 503, "Out of memory");
+    }
+
+    size_t len = filesystem_to_json(json, JSON_BUFFER_SIZE);
+    if (len == 0) {
+        memory_budget_free(json);
+        return send_error_response(req, 500, "Storage report too large");
+    }
+
+    httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+    esp_err_t ret = send_json(req, json, len);
+
+    memory_budget_free(json);
+    return ret;
+}
+
+#if CONFIG_TRACE_ENABLE
+static esp_err_t trace_send_chunk(void *ctx, const char *data, size_t len) {
+    return httpd_resp_send_chunk(ctx, data, len);
+}
+
+static esp_err_t trace_send_gzip(void *ctx, const char *data, size_t len) {
+    return gzip_stream_write(ctx, data, len);
+}
+
+static esp_err_t trace_handler(httpd_req_t *req) {
+    esp_err_t ret;
+
+    // Streamed, the full rings do not fit in one buffer
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+    httpd_resp_set_hdr(req, "Vary", "Accept-Encoding");
+
+    if (accepts_gzip(req)) {
+        httpd_resp_set_hdr(req, "Content-Encoding", "gzip");
+        gzip_stream_init(&gzip, send_gzip_chunk, req);
+        ret = trace_export(trace_send_gzip, &gzip);
+        if (ret == ESP_OK) {
+            ret = gzip_stream_finish(&gzip);
+        }
+    } else {
+        ret = trace_export(trace_send_chunk, req);
+    }
+
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to send trace");
+        return ret;
+    }
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
+#endif
+
+/**
+ * Every URI goes through here with the real handler in user_ctx, so the CPU
+ * runs at full speed and cannot light-sleep while a request is in flight.
+ */
+static esp_err_t powered_handler(httpd_req_t *req) {
+    TRACE_SCOPE_ARG("http_request", req->uri);
+    esp_err_t (*handler)(httpd_req_t *) = req->user_ctx;
+
+    power_request_begin();
+    esp_err_t ret = handler(req);
+    power_request_end();
+
+    return ret;
+}
+
+static esp_err_t session_open(httpd_handle_t hd, int sockfd) {
+    power_connection_opened();
+    return ESP_OK;
+}
+
 // clang-format off
 static const httpd_uri_t root_uri = {
     .uri = "/",
     .method = HTTP_GET,
-    .handler = root_handler,
-    .user_ctx = NULL
+    .handler = powered_handler,
+    .user_ctx = root_handler
 };
 static const httpd_uri_t static_uri = {
     .uri = "/assets/*",
     .method = HTTP_GET,
-    .handler = static_handler,
-    .user_ctx = NULL
+    .handler = powered_handler,
+    .user_ctx = static_handler
+};
+static const httpd_uri_t nowplaying_uri = {
+    .uri = "/api/nowplaying",
+    .method = HTTP_GET,
+    .handler = powered_handler,
+    .user_ctx = nowplaying_handler
+};
+static const httpd_uri_t memory_uri = {
+    .uri = "/api/memory",
+    .method = HTTP_GET,
+    .handler = powered_handler,
+    .user_ctx = memory_handler
+};
+static const httpd_uri_t power_uri = {
+    .uri = "/api/power",
+    .method = HTTP_GET,
+    .handler = powered_handler,
+    .user_ctx = power_handler
+};
+static const httpd_uri_t events_uri = {
+    .uri = "/api/events",
+    .method = HTTP_GET,
+    .handler = powered_handler,
+    .user_ctx = events_handler
+};
+static const httpd_uri_t network_uri = {
+    .uri = "/api/network",
+    .method = HTTP_GET,
+    .handler = powered_handler,
+    .user_ctx = network_handler
+};
+static const httpd_uri_t storage_uri = {
+    .uri = "/api/storage",
+    .method = HTTP_GET,
+    .handler = powered_handler,
+    .user_ctx = storage_handler
+};
+#if CONFIG_TRACE_ENABLE
+static const httpd_uri_t trace_uri = {
+    .uri = "/api/trace",
+    .method = HTTP_GET,
+    .handler = powered_handler,
+    .user_ctx = trace_handler
 };
+#endif
+#if CONFIG_WEBSERVER_FS_API
+static const httpd_uri_t fs_get_uri = {
+    .uri = FS_API_PREFIX "/*",
+    .method = HTTP_GET,
+    .handler = powered_handler,
+    .user_ctx = fs_get_handler
+};
+static const httpd_uri_t fs_put_uri = {
+    .uri = FS_API_PREFIX "/*",
+    .method = HTTP_PUT,
+    .handler = powered_handler,
+    .user_ctx = fs_put_handler
+};
+static const httpd_uri_t fs_delete_uri = {
+    .uri = FS_API_PREFIX "/*",
+    .method = HTTP_DELETE,
+    .handler = powered_handler,
+    .user_ctx = fs_delete_handler
+};
+#endif
 // clang-format on
 
 httpd_handle_t webserver_init(void) {
@@ -124,6 +584,8 @@ httpd_handle_t webserver_init(void) {
     httpd_config_t config = HTTPD_DEFAULT_CONFIG();
     config.lru_purge_enable = true;
     config.uri_match_fn = httpd_uri_match_wildcard;
+    config.max_uri_handlers = 16;
+    config.open_fn = session_open;
 
     ESP_LOGI(TAG, "Starting HTTP server on port %d", config.server_port);
 
@@ -140,6 +602,52 @@ httpd_handle_t webserver_init(void) {
         }
         ESP_LOGI(TAG, "Registered URI handler: GET /assets/*");
 
+        if (httpd_register_uri_handler(server, &nowplaying_uri) != ESP_OK) {
+            ESP_LOGI(TAG, "Failed to register URI handler: GET /api/nowplaying");
+        }
+        ESP_LOGI(TAG, "Registered URI handler: GET /api/nowplaying");
+
+        if (httpd_register_uri_handler(server, &memory_uri) != ESP_OK) {
+            ESP_LOGI(TAG, "Failed to register URI handler: GET /api/memory");
+        }
+        ESP_LOGI(TAG, "Registered URI handler: GET /api/memory");
+
+        if (httpd_register_uri_handler(server, &power_uri) != ESP_OK) {
+            ESP_LOGI(TAG, "Failed to register URI handler: GET /api/power");
+        }
+        ESP_LOGI(TAG, "Registered URI handler: GET /api/power");
+
+        if (httpd_register_uri_handler(server, &events_uri) != ESP_OK) {
+            ESP_LOGI(TAG, "Failed to register URI handler: GET /api/events");
+        }
+        ESP_LOGI(TAG, "Registered URI handler: GET /api/events");
+
+        if (httpd_register_uri_handler(server, &network_uri) != ESP_OK) {
+            ESP_LOGI(TAG, "Failed to register URI handler: GET /api/network");
+        }
+        ESP_LOGI(TAG, "Registered URI handler: GET /api/network");
+
+        if (httpd_register_uri_handler(server, &storage_uri) != ESP_OK) {
+            ESP_LOGI(TAG, "Failed to register URI handler: GET /api/storage");
+        }
+        ESP_LOGI(TAG, "Registered URI handler: GET /api/storage");
+
+#if CONFIG_TRACE_ENABLE
+        if (httpd_register_uri_handler(server, &trace_uri) != ESP_OK) {
+            ESP_LOGI(TAG, "Failed to register URI handler: GET /api/trace");
+        }
+        ESP_LOGI(TAG, "Registered URI handler: GET /api/trace");
+#endif
+
+#if CONFIG_WEBSERVER_FS_API
+        if (httpd_register_uri_handler(server, &fs_get_uri) != ESP_OK ||
+            httpd_register_uri_handler(server, &fs_put_uri) != ESP_OK ||
+            httpd_register_uri_handler(server, &fs_delete_uri) != ESP_OK) {
+            ESP_LOGI(TAG, "Failed to register URI handlers: " FS_API_PREFIX "/*");
+        }
+        ESP_LOGW(TAG, "Registered URI handlers: GET/PUT/DELETE " FS_API_PREFIX "/* (unauthenticated, development only)");
+#endif
+
         esp_netif_t *ap_netif = esp_netif_get_handle_from_ifkey("WIFI_AP_DEF");
         if (ap_netif != NULL) {
             esp_netif_ip_info_t ip_info;
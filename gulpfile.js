@@ -5,6 +5,7 @@ const rename = require('gulp-rename');
 const replace = require('gulp-replace');
 const sass = require('gulp-sass')(require('sass'));
 const fs = require('fs');
+const http = require('http');
 const path = require('path');
 
 const paths = {
@@ -54,32 +55,128 @@ async function js() {
     });
 }
 
+// Stand-ins for the {{slot}} values the webserver fills in, so the copy in
+// data/www renders sensibly in the dev server; the device renders / from
+// index_template.h and never serves this file
+function devSlots() {
+    const config = fs.readFileSync('include/radio_wazoo_config.h', 'utf8');
+    const ssid = config.match(/#define\s+WIFI_AP_SSID\s+"([^"]*)"/);
+
+    return {
+        ssid: ssid ? ssid[1] : 'RadioWazooAP',
+        station: 'Dev Station',
+        title: 'Dev Artist - Dev Title'
+    };
+}
+
 function html() {
+    const slots = devSlots();
+
     return gulp.src(paths.html.src)
         .pipe(replace(/\.css(?=")/g, '.min.css'))
         .pipe(replace(/\.js(?=")/g, '.min.js'))
+        .pipe(replace(/\{\{\s*(\w+)\s*\}\}/g, (match, name) => slots[name] ?? ''))
         .pipe(gulp.dest(paths.html.dest));
 }
 
+// Split index.html on {{slot}} placeholders into a segment table for the
+// webserver, so the page is streamed from flash with live values filled in
+function templates(done) {
+    const source = fs.readFileSync('src/www/index.html', 'utf8')
+        .replace(/\.css(?=")/g, '.min.css')
+        .replace(/\.js(?=")/g, '.min.js');
+
+    const literal = (text) => JSON.stringify(text).replace(/\\u([0-9a-f]{4})/g, '\\x$1');
+    const segments = [];
+    const pattern = /\{\{\s*(\w+)\s*\}\}/g;
+    let last = 0;
+    let match;
+
+    while ((match = pattern.exec(source)) !== null) {
+        if (match.index > last) {
+            segments.push(`TEMPLATE_TEXT_SEGMENT(${literal(source.slice(last, match.index))})`);
+        }
+        segments.push(`TEMPLATE_SLOT_SEGMENT(TEMPLATE_SLOT_${match[1].toUpperCase()})`);
+        last = pattern.lastIndex;
+    }
+    if (last < source.length) {
+        segments.push(`TEMPLATE_TEXT_SEGMENT(${literal(source.slice(last))})`);
+    }
+
+    const header = [
+        '// Generated by npx gulp templates from src/www/index.html - do not edit',
+        '#ifndef INDEX_TEMPLATE_H',
+        '#define INDEX_TEMPLATE_H',
+        '',
+        '#include "template.h"',
+        '',
+        'static const template_segment_t index_template[] = {',
+        ...segments.map((segment) => `    ${segment},`),
+        '};',
+        '',
+        '#endif // INDEX_TEMPLATE_H',
+        ''
+    ].join('\n');
+
+    fs.writeFileSync('components/webserver/index_template.h', header);
+    done();
+}
+
 function images() {
     return gulp.src(paths.images.src)
         .pipe(gulp.dest(paths.images.dest));
 }
 
+const contentTypes = {
+    '.html': 'text/html',
+    '.css': 'text/css',
+    '.js': 'text/javascript',
+    '.svg': 'image/svg+xml',
+    '.png': 'image/png',
+    '.ico': 'image/x-icon'
+};
+
+// Serve the built data/www, since src/www has unfilled slots, SCSS and unbundled modules
+function serve() {
+    const root = path.resolve('data/www');
+
+    http.createServer((req, res) => {
+        let url = '';
+        try {
+            url = decodeURIComponent(req.url.split('?')[0]);
+        } catch (e) {
+            // malformed escapes fall through to 404
+        }
+        const file = path.join(root, url === '/' ? 'index.html' : url);
+
+        if (!file.startsWith(root + path.sep) || !fs.existsSync(file) || !fs.statSync(file).isFile()) {
+            res.writeHead(404);
+            res.end('Not found');
+            return;
+        }
+        res.writeHead(200, {'Content-Type': contentTypes[path.extname(file)] || 'application/octet-stream'});
+        fs.createReadStream(file).pipe(res);
+    }).listen(8888, () => console.log('Serving data/www at http://localhost:8888'));
+}
+
 function watch() {
     gulp.watch(paths.scss.src, scss);
     gulp.watch(paths.js.src, js);
-    gulp.watch(paths.html.src, html);
+    gulp.watch(paths.html.src, gulp.parallel(html, templates));
     gulp.watch(paths.images.src, images);
 }
 
-const build = gulp.series(clean, gulp.parallel(scss, js, html, images));
+const build = gulp.series(clean, gulp.parallel(scss, js, html, templates, images));
+const dev = gulp.series(build, gulp.parallel(watch, serve));
 
 exports.clean = clean;
 exports.scss = scss;
 exports.js = js;
 exports.html = html;
+exports.templates = templates;
 exports.images = images;
 exports.watch = watch;
+exports.serve = serve;
+exports.dev = dev;
 exports.build = build;
 exports.default = build;
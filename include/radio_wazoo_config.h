@@ -11,6 +11,11 @@ extern "C" {
 #define WIFI_AP_CHANNEL   1
 #define WIFI_AP_MAX_CONN  4
 
+// WiFi Station Configuration (credentials come from Network/SSID and Network/Password settings)
+#define WIFI_STA_BACKOFF_BASE_MS     250   // second retry delay, doubled per failure (first is immediate)
+#define WIFI_STA_BACKOFF_MAX_MS      30000
+#define WIFI_STA_CACHE_MAX_FAILURES  2     // failed attempts on the cached BSSID/channel before a full scan
+
 // IP address (OCTETS)
 #define AP_IP_1             192
 #define AP_IP_2             168
@@ -27,7 +32,59 @@ IP4_ADDR(&(ip_info).netmask,  255,     255,     255,     0); \
 // Filesystem Configuration
 #define LITTLEFS_BASE_PATH "/littlefs"
 #define LITTLEFS_PARTITION_LABEL "storage"
+#define FILESYSTEM_STATS_MAX_PATHS    16     // paths with write counts, the least written is evicted
+#define FILESYSTEM_HISTORY_SIZE       24     // used-bytes samples kept for the trend
+#define FILESYSTEM_SAMPLE_INTERVAL_MS 300000 // usage sample period while no writes happen
+#define FILESYSTEM_STATS_IDLE_MS      3000   // quiet time after the last write before GC runs and stats are saved
+#define FILESYSTEM_ERASE_CYCLES       100000 // rated erase cycles per flash sector, for the wear estimate
+#define FILESYSTEM_BLOCK_SIZE         4096   // LittleFS block = flash sector
+#define FILESYSTEM_IO_SIZE            128    // LittleFS read/prog size, as esp_littlefs so existing images mount
+#define FILESYSTEM_CACHE_SIZE         512    // LittleFS cache, one more per open file
+#define FILESYSTEM_LOOKAHEAD_SIZE     128    // free-block bitmap bytes, 8 blocks each
+#define FILESYSTEM_BLOCK_CYCLES       512    // erases before LittleFS moves a metadata pair
+#define FILESYSTEM_COMPACT_THRESH     3072   // idle GC compacts metadata blocks filled beyond this
+#define FILESYSTEM_MAX_OPEN_FILES     8
+
+// Audio Output Configuration
+#define AUDIO_OUTPUT_SAMPLE_RATE  44100 // Device (sink) sample rate, Hz
+#define AUDIO_OUTPUT_BLOCK_FRAMES 512   // Stereo frames per double-buffer half
+#define AUDIO_OUTPUT_VOLUME       80    // Initial volume, percent
+#define AUDIO_I2S_BCLK_GPIO       16
+#define AUDIO_I2S_WS_GPIO         17
+#define AUDIO_I2S_DOUT_GPIO       18
+#define AUDIO_OUTPUT_WAV_PATH     "audio_output.wav" // Host (linux target) WAV sink
+
+// Memory Budget Configuration (bytes per component and region)
+#define MEMORY_BUDGET_WEBSERVER_INTERNAL (12 * 1024)
+#define MEMORY_BUDGET_WEBSERVER_SPIRAM   (64 * 1024)
+#define MEMORY_BUDGET_AUDIO_INTERNAL     (8 * 1024) // output double buffers, 2 x AUDIO_OUTPUT_BLOCK_FRAMES stereo frames
+#define MEMORY_SHED_MIN_FREE             (24 * 1024) // shed load below this much free internal RAM
+#define MEMORY_SHED_MIN_LARGEST_BLOCK    (8 * 1024)  // ...or when the largest internal block is smaller
+#define MEMORY_SAMPLE_INTERVAL_MS        5000
+#define MEMORY_HISTORY_SIZE              24
+
+// Power Management Configuration
+#define POWER_CPU_MAX_MHZ   240
+#define POWER_CPU_MIN_MHZ   80
+#define POWER_IDLE_AFTER_MS 10000 // quiet time after which the next request counts as a wake-up
+#define POWER_EST_ACTIVE_MA 110   // assumed per-state current draw for the average estimate (not measured)
+#define POWER_EST_IDLE_MA   75
+#define POWER_EST_SLEEP_MA  30
+
+// Event Bus Configuration
+#define EVENT_BUS_POOL_SIZE       32 // events in flight across all subscribers, at most 32
+#define EVENT_BUS_QUEUE_DEPTH     16 // pending events per subscriber, power of two
+#define EVENT_BUS_MAX_SUBSCRIBERS 6
+
+// Trace Configuration (only used with CONFIG_TRACE_ENABLE)
+#define TRACE_RING_SIZE     64 // spans kept per task, oldest overwritten
+#define TRACE_MAX_TASKS     8  // live tasks that get a ring, spans from further tasks are dropped
+#define TRACE_ARG_RING_SIZE 16 // span details (request URIs) kept per task
+#define TRACE_ARG_SIZE      48 // bytes per detail including the terminator, longer ones are cut
+#define TRACE_TLS_INDEX     1  // FreeRTOS TLS slot holding the task's ring (0 belongs to pthread)
 
+// Web Server Configuration
+#define WEBSERVER_GZIP_MIN_SIZE 512 // gzip JSON responses at least this large, if the client accepts it
 
 #ifdef __cplusplus
 }
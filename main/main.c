@@ -1,11 +1,19 @@
 #include "access_point.h"
+#include "audio_output.h"
 #include "esp_err.h"
 #include "esp_log.h"
 #include "esp_system.h"
+#include "event_bus.h"
 #include "filesystem.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "memory_budget.h"
+#include "nowplaying.h"
 #include "nvs.h"
+#include "power.h"
+#include "radio_wazoo_config.h"
+#include "sdkconfig.h"
+#include "settings.h"
 #include "webserver.h"
 #include <inttypes.h>
 #include <stdio.h>
@@ -13,8 +21,15 @@
 static const char *const TAG = "MAIN";
 
 void app_loop(void) {
+    power_state_t previous = POWER_STATE_SLEEP;
     while (1) {
-        vTaskDelay(pdMS_TO_TICKS(1000));
+        // Sleeps until something changes instead of waking up on a timer
+        power_state_t state = power_wait_state_change(portMAX_DELAY);
+        if ((state == POWER_STATE_SLEEP) != (previous == POWER_STATE_SLEEP)) {
+            ESP_LOGI(TAG, "Power state: %s", power_state_name(state));
+            power_log_stats();
+        }
+        previous = state;
     }
 }
 
@@ -22,18 +37,43 @@ void app_main(void) {
     ESP_LOGI(TAG, "=== Radio Wazoo ===");
     ESP_LOGI(TAG, "Free heap: %" PRIu32 " bytes", esp_get_free_heap_size());
 
+    ESP_LOGI(TAG, "Initializing memory budgets...");
+    ESP_ERROR_CHECK(memory_budget_init());
+
+    ESP_LOGI(TAG, "Initializing event bus...");
+    ESP_ERROR_CHECK(event_bus_init());
+
     ESP_LOGI(TAG, "Initializing non-volatile storage...");
     ESP_ERROR_CHECK(nvs_init());
 
+    ESP_LOGI(TAG, "Loading settings...");
+    ESP_ERROR_CHECK(settings_init());
+
     ESP_LOGI(TAG, "Starting WiFi Access Point...");
     ESP_ERROR_CHECK(access_point_init());
 
+    ESP_LOGI(TAG, "Configuring power management...");
+    ESP_ERROR_CHECK(power_init());
+
     ESP_LOGI(TAG, "Initializing filesystem...");
     ESP_ERROR_CHECK(filesystem_init());
 
+    ESP_LOGI(TAG, "Initializing now-playing cache...");
+    ESP_ERROR_CHECK(nowplaying_init());
+
     ESP_LOGI(TAG, "Starting web server...");
     webserver_init();
 
+    ESP_LOGI(TAG, "Starting audio output...");
+    ESP_ERROR_CHECK(audio_output_init(&audio_sink_i2s, AUDIO_OUTPUT_SAMPLE_RATE));
+
+#if CONFIG_BENCHMARK_AT_BOOT
+    ESP_LOGI(TAG, "Running benchmarks...");
+    audio_output_benchmark();
+    webserver_gzip_benchmark();
+    event_bus_benchmark(10000);
+#endif
+
     ESP_LOGI(TAG, "Initialization complete. Entering main loop...");
     app_loop(); // never returns
 }
@@ -17,6 +17,7 @@ DATA_DIR="data"
 PARTITION_NAME="storage"
 FS_IMAGE="build/littlefs.bin"
 FS_FLASH_MARKER="build/.littlefs_flashed"
+FS_MANIFEST=".fs_manifest"
 SSID="RadioWazooAP"
 IP="192.168.4.1"
 
@@ -54,6 +55,7 @@ function print_help() {
   echo "Commands:"
   echo "  build            - Build firmware, flash all, reset device, and verify boot"
   echo "  verify           - Verify device boot status (check WiFi AP)"
+  echo "  sync             - Push only changed data/ files to a running device over HTTP"
   echo "  format           - Reformat code in C/C++ files using clang-format"
   echo "  tidy             - Run clang-tidy linting on C/C++ files"
   echo "  help             - Show this help message"
@@ -67,6 +69,7 @@ function print_help() {
   echo "  ./utility.sh build"
   echo "  PORT=/dev/ttyUSB0 ./utility.sh build"
   echo "  ./utility.sh verify"
+  echo "  ./utility.sh sync"
   echo ""
   echo "The 'build' command performs:"
   echo "  1. Firmware build (idf.py build)"
@@ -267,6 +270,118 @@ flash_filesystem() {
   fi
 }
 
+# Build "<sha256>  <path>" lines for every file under data/, paths relative to the filesystem root
+build_manifest() {
+  (cd "$DATA_DIR" && find . -type f ! -name "$FS_MANIFEST" ! -name ".gitignore" -print0 | sort -z | xargs -0 -r sha256sum) |
+    sed 's|  \./|  |'
+}
+
+# Percent-encode a path for a URL, keeping "/" as the separator
+url_encode_path() {
+  local LC_ALL=C path="$1" out="" c i
+  for ((i = 0; i < ${#path}; i++)); do
+    c="${path:i:1}"
+    case "$c" in
+    [A-Za-z0-9/._~-]) out+="$c" ;;
+    *) out+=$(printf '%%%02X' "'$c") ;;
+    esac
+  done
+  printf '%s' "$out"
+}
+
+# Delta filesystem sync over HTTP (device must be running and reachable at $IP,
+# firmware built with CONFIG_WEBSERVER_FS_API)
+sync_filesystem() {
+  log_step "Syncing filesystem over HTTP"
+
+  if [ ! -d "$DATA_DIR" ]; then
+    log_error "Data directory '$DATA_DIR' not found"
+    exit 1
+  fi
+
+  if ! command -v curl &>/dev/null || ! command -v sha256sum &>/dev/null; then
+    log_error "curl and sha256sum are required for filesystem sync"
+    exit 1
+  fi
+
+  local base_url="http://$IP/api/fs"
+  local local_manifest remote_manifest
+  local_manifest=$(mktemp)
+  remote_manifest=$(mktemp)
+
+  local start_ns
+  start_ns=$(date +%s%N)
+
+  build_manifest >"$local_manifest"
+
+  if ! curl -sf "$base_url/$FS_MANIFEST" -o "$remote_manifest"; then
+    log_warn "No manifest on device, every file will be uploaded"
+    : >"$remote_manifest"
+  fi
+
+  # Manifest lines are "<64 hex digits><2 spaces><path>"; the path is the rest of the line, spaces included.
+  # FILENAME, not NR == FNR, tells the files apart: the first one may be empty
+  # Files whose hash differs from (or is missing in) the device manifest
+  local changed deleted
+  changed=$(awk 'FILENAME == ARGV[1] { remote[substr($0, 67)] = $1; next } remote[substr($0, 67)] != $1 { print substr($0, 67) }' \
+    "$remote_manifest" "$local_manifest")
+  # Files listed on the device but gone locally
+  deleted=$(awk 'FILENAME == ARGV[1] { present[substr($0, 67)] = 1; next } !(substr($0, 67) in present) { print substr($0, 67) }' \
+    "$local_manifest" "$remote_manifest")
+
+  local uploaded_files=0 uploaded_bytes=0 deleted_files=0
+  local path
+  while IFS= read -r path; do
+    [ -z "$path" ] && continue
+    log_info "Uploading $path"
+    if ! curl -sf -X PUT --data-binary @"$DATA_DIR/$path" "$base_url/$(url_encode_path "$path")" >/dev/null; then
+      log_error "Upload failed: $path (is the firmware built with CONFIG_WEBSERVER_FS_API?)"
+      rm -f "$local_manifest" "$remote_manifest"
+      exit 1
+    fi
+    uploaded_files=$((uploaded_files + 1))
+    uploaded_bytes=$((uploaded_bytes + $(stat -c %s "$DATA_DIR/$path")))
+  done <<<"$changed"
+
+  while IFS= read -r path; do
+    [ -z "$path" ] && continue
+    log_info "Deleting $path"
+    # A 404 means the file is already gone, which is what we want
+    local status
+    status=$(curl -s -o /dev/null -w '%{http_code}' -X DELETE "$base_url/$(url_encode_path "$path")")
+    if [ "$status" != 200 ] && [ "$status" != 404 ]; then
+      log_error "Delete failed: $path (HTTP $status)"
+      rm -f "$local_manifest" "$remote_manifest"
+      exit 1
+    fi
+    deleted_files=$((deleted_files + 1))
+  done <<<"$deleted"
+
+  # Manifest goes last so an interrupted sync is simply retried next time
+  if [ $((uploaded_files + deleted_files)) -gt 0 ]; then
+    if ! curl -sf -X PUT --data-binary @"$local_manifest" "$base_url/$FS_MANIFEST" >/dev/null; then
+      log_error "Failed to store manifest on device"
+      rm -f "$local_manifest" "$remote_manifest"
+      exit 1
+    fi
+  fi
+
+  local elapsed_ms=$((($(date +%s%N) - start_ns) / 1000000))
+  rm -f "$local_manifest" "$remote_manifest"
+
+  log_info "Uploaded $uploaded_files file(s), $uploaded_bytes bytes; deleted $deleted_files file(s)"
+  log_info "Delta sync time: ${elapsed_ms} ms"
+
+  # A full flash writes the whole image; esptool runs at roughly 10 bits per byte on the wire
+  local image_bytes
+  if [ -f "$FS_IMAGE" ]; then
+    image_bytes=$(stat -c %s "$FS_IMAGE")
+  else
+    image_bytes=$(du -sb "$DATA_DIR" | awk '{print $1}')
+  fi
+  log_info "Full flash estimate: $((image_bytes * 10 * 1000 / BAUD)) ms for $image_bytes bytes at $BAUD baud (plus erase)"
+}
+
 # Step 4: Reset device
 reset_device() {
   log_step "=== Step 4: Resetting device ==="
@@ -318,6 +433,9 @@ build)
 verify)
   verify_boot
   ;;
+sync)
+  sync_filesystem
+  ;;
 help | --help | -h | "")
   print_help
   ;;